@@ -0,0 +1,333 @@
+/* Copyright (C) 2025 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+// Feeds wav files to stt engine through borrow_buf/return_buf and reports
+// realtime factor, time to first intermediate text and peak RSS as json.
+// Input files must be 16 kHz mono s16 wav.
+//
+// usage: stt_bench --engine <whisper|fasterwhisper|vosk|april|ds>
+//                  --model <model> [--scorer <file>] [--lang <id>]
+//                  [--threads <n>] [--beam <n>] [--realtime] <file.wav>...
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "april_engine.hpp"
+#include "audio_tools.hpp"
+#include "ds_engine.hpp"
+#include "fasterwhisper_engine.hpp"
+#include "py_executor.hpp"
+#include "vosk_engine.hpp"
+#include "whisper_engine.hpp"
+
+using clock_type = std::chrono::steady_clock;
+
+static const size_t sample_rate = 16000;
+
+struct result_t {
+    std::string file;
+    double audio_sec = 0;
+    double processing_sec = 0;
+    std::optional<double> first_text_sec;
+    std::string text;
+};
+
+// state shared with engine callbacks
+struct session_t {
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool eof = false;
+    std::atomic_bool error = false;
+    clock_type::time_point start;
+    std::optional<clock_type::time_point> first_text;
+    std::string text;
+
+    void reset() {
+        std::lock_guard lock{mtx};
+        eof = false;
+        error = false;
+        start = clock_type::now();
+        first_text.reset();
+        text.clear();
+    }
+};
+
+static std::string json_escape(const std::string& str) {
+    std::string escaped;
+    escaped.reserve(str.size());
+
+    for (auto c : str) {
+        switch (c) {
+            case '"':
+                escaped.append("\\\"");
+                break;
+            case '\\':
+                escaped.append("\\\\");
+                break;
+            case '\n':
+                escaped.append("\\n");
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof buf, "\\u%04x", c);
+                    escaped.append(buf);
+                } else {
+                    escaped.push_back(c);
+                }
+        }
+    }
+
+    return escaped;
+}
+
+static size_t peak_rss_kb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss);  // kB on linux
+}
+
+static std::unique_ptr<stt_engine> make_engine(
+    const std::string& name, stt_engine::config_t config,
+    stt_engine::callbacks_t call_backs) {
+    if (name == "whisper")
+        return std::make_unique<whisper_engine>(std::move(config),
+                                                std::move(call_backs));
+    if (name == "fasterwhisper") {
+        py_executor::instance()->start();
+        return std::make_unique<fasterwhisper_engine>(std::move(config),
+                                                      std::move(call_backs));
+    }
+    if (name == "vosk")
+        return std::make_unique<vosk_engine>(std::move(config),
+                                             std::move(call_backs));
+    if (name == "april")
+        return std::make_unique<april_engine>(std::move(config),
+                                              std::move(call_backs));
+    if (name == "ds")
+        return std::make_unique<ds_engine>(std::move(config),
+                                           std::move(call_backs));
+    return {};
+}
+
+static result_t run_file(stt_engine& engine, session_t& session,
+                         const std::vector<int16_t>& samples, bool realtime) {
+    result_t result;
+    result.audio_sec = static_cast<double>(samples.size()) / sample_rate;
+
+    session.reset();
+
+    size_t pos = 0;
+    bool sof = true;
+
+    while (!session.error) {
+        if (realtime) {
+            // don't feed audio faster than it would come from mic
+            auto elapsed = std::chrono::duration<double>(clock_type::now() -
+                                                         session.start);
+            if (static_cast<double>(pos) > elapsed.count() * sample_rate) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{10});
+                continue;
+            }
+        }
+
+        auto [buf, max_size] = engine.borrow_buf();
+        if (!buf) {
+            // in-ring is full
+            std::this_thread::sleep_for(std::chrono::milliseconds{5});
+            continue;
+        }
+
+        auto size = std::min(max_size / sizeof(int16_t), samples.size() - pos);
+        if (realtime) size = std::min(size, sample_rate / 10);
+
+        std::copy(samples.cbegin() + pos, samples.cbegin() + pos + size,
+                  reinterpret_cast<int16_t*>(buf));
+        pos += size;
+
+        bool eof = pos == samples.size();
+        engine.return_buf(buf, size * sizeof(int16_t), sof, eof);
+        sof = false;
+
+        if (eof) break;
+    }
+
+    std::unique_lock lock{session.mtx};
+    session.cv.wait(lock, [&] { return session.eof || session.error; });
+
+    result.processing_sec =
+        std::chrono::duration<double>(clock_type::now() - session.start)
+            .count();
+    if (session.first_text)
+        result.first_text_sec =
+            std::chrono::duration<double>(*session.first_text - session.start)
+                .count();
+    result.text = session.text;
+
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    std::string engine_name;
+    stt_engine::config_t config;
+    config.lang = "en";
+    config.speech_mode = stt_engine::speech_mode_t::automatic;
+    bool realtime = false;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg{argv[i]};
+        if (arg == "--engine" && i + 1 < argc)
+            engine_name = argv[++i];
+        else if (arg == "--model" && i + 1 < argc)
+            config.model_files.model_file = argv[++i];
+        else if (arg == "--scorer" && i + 1 < argc)
+            config.model_files.scorer_file = argv[++i];
+        else if (arg == "--lang" && i + 1 < argc)
+            config.lang = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc)
+            config.cpu_threads = std::stoul(argv[++i]);
+        else if (arg == "--beam" && i + 1 < argc)
+            config.beam_search = std::stoul(argv[++i]);
+        else if (arg == "--realtime")
+            realtime = true;
+        else
+            files.push_back(std::move(arg));
+    }
+
+    if (engine_name.empty() || config.model_files.model_file.empty() ||
+        files.empty()) {
+        std::cerr << "usage: " << argv[0]
+                  << " --engine <whisper|fasterwhisper|vosk|april|ds> "
+                     "--model <model> [--scorer <file>] [--lang <id>] "
+                     "[--threads <n>] [--beam <n>] [--realtime] "
+                     "<file.wav>...\n";
+        return 1;
+    }
+
+    // file mode lets engines decode without waiting for realtime audio
+    config.offline = !realtime;
+    config.lang_code = config.lang;
+
+    session_t session;
+
+    stt_engine::callbacks_t call_backs;
+    call_backs.intermediate_text_decoded = [&](const std::string& text,
+                                               const std::string&) {
+        std::lock_guard lock{session.mtx};
+        if (!session.first_text && !text.empty())
+            session.first_text = clock_type::now();
+    };
+    call_backs.text_decoded = [&](const std::string& text,
+                                  const std::string&) {
+        std::lock_guard lock{session.mtx};
+        if (!session.first_text && !text.empty())
+            session.first_text = clock_type::now();
+        if (!session.text.empty()) session.text.push_back(' ');
+        session.text.append(text);
+    };
+    call_backs.eof = [&] {
+        std::lock_guard lock{session.mtx};
+        session.eof = true;
+        session.cv.notify_one();
+    };
+    call_backs.error = [&] {
+        std::lock_guard lock{session.mtx};
+        session.error = true;
+        session.cv.notify_one();
+    };
+    // engines call these unconditionally
+    call_backs.speech_detection_status_changed =
+        [](stt_engine::speech_detection_status_t) {};
+    call_backs.sentence_timeout = [] {};
+    call_backs.stopping = [] {};
+    call_backs.stopped = [] {};
+
+    std::unique_ptr<stt_engine> engine;
+    try {
+        engine = make_engine(engine_name, config, std::move(call_backs));
+    } catch (const std::runtime_error& err) {
+        std::cerr << "failed to create engine: " << err.what() << "\n";
+        return 1;
+    }
+
+    if (!engine) {
+        std::cerr << "unknown engine: " << engine_name << "\n";
+        return 1;
+    }
+
+    engine->start();
+
+    std::vector<result_t> results;
+    double total_audio_sec = 0;
+    double total_processing_sec = 0;
+
+    for (const auto& file : files) {
+        auto samples = audio_tools::read_wav_s16(file, sample_rate);
+        if (!samples) {
+            std::cerr << "skipping unsupported file: " << file << "\n";
+            continue;
+        }
+
+        auto result = run_file(*engine, session, *samples, realtime);
+        if (session.error) {
+            std::cerr << "engine error: " << file << "\n";
+            break;
+        }
+        result.file = file;
+
+        total_audio_sec += result.audio_sec;
+        total_processing_sec += result.processing_sec;
+        results.push_back(std::move(result));
+    }
+
+    engine->stop();
+
+    std::cout << "{\"engine\":\"" << json_escape(engine_name)
+              << "\",\"model\":\""
+              << json_escape(config.model_files.model_file)
+              << "\",\"realtime\":" << (realtime ? "true" : "false")
+              << ",\"files\":[";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        if (i > 0) std::cout << ",";
+        std::cout << "{\"file\":\"" << json_escape(result.file)
+                  << "\",\"audio_sec\":" << result.audio_sec
+                  << ",\"processing_sec\":" << result.processing_sec
+                  << ",\"rtf\":"
+                  << (result.audio_sec > 0
+                          ? result.processing_sec / result.audio_sec
+                          : 0.0)
+                  << ",\"first_text_sec\":";
+        if (result.first_text_sec)
+            std::cout << *result.first_text_sec;
+        else
+            std::cout << "null";
+        std::cout << ",\"text\":\"" << json_escape(result.text) << "\"}";
+    }
+
+    std::cout << "],\"audio_sec\":" << total_audio_sec
+              << ",\"processing_sec\":" << total_processing_sec << ",\"rtf\":"
+              << (total_audio_sec > 0 ? total_processing_sec / total_audio_sec
+                                      : 0.0)
+              << ",\"peak_rss_kb\":" << peak_rss_kb() << "}\n";
+
+    return 0;
+}
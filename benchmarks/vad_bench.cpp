@@ -0,0 +1,121 @@
+/* Copyright (C) 2025 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+// Reports how many seconds of audio each vad backend passes to the decoder
+// per second of input audio. Input files must be 16 kHz mono s16 wav.
+//
+// usage: vad_bench [--silero-model <file.onnx>] <file.wav>...
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "audio_tools.hpp"
+#include "vad.hpp"
+
+static const size_t sample_rate = 16000;
+static const size_t block_size = 24000;  // same as stt engine input block
+
+struct result_t {
+    size_t audio_samples = 0;
+    size_t speech_samples = 0;
+    std::chrono::duration<double> vad_time{0};
+};
+
+static result_t run_vad(vad& vad, const std::vector<int16_t>& samples) {
+    result_t result;
+    result.audio_samples = samples.size();
+
+    vad.restart();
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t pos = 0; pos < samples.size(); pos += block_size) {
+        auto size = std::min(block_size, samples.size() - pos);
+        result.speech_samples +=
+            vad.remove_silence(samples.data() + pos, size).size();
+    }
+
+    result.vad_time = std::chrono::steady_clock::now() - start;
+
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    std::string silero_model;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg{argv[i]};
+        if (arg == "--silero-model" && i + 1 < argc)
+            silero_model = argv[++i];
+        else
+            files.push_back(std::move(arg));
+    }
+
+    if (files.empty()) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--silero-model <file.onnx>] <file.wav>...\n";
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, vad::config_t>> backends;
+    for (int mode = 0; mode <= 3; ++mode) {
+        vad::config_t config;
+        config.webrtc_mode = mode;
+        backends.emplace_back("webrtc-" + std::to_string(mode), config);
+    }
+    if (!silero_model.empty()) {
+        vad::config_t config;
+        config.backend_type = vad::backend_type_t::silero;
+        config.model_file = silero_model;
+        backends.emplace_back("silero", config);
+    }
+
+    std::vector<std::vector<int16_t>> corpus;
+    for (const auto& file : files) {
+        if (auto samples = audio_tools::read_wav_s16(file, sample_rate))
+            corpus.push_back(std::move(*samples));
+        else
+            std::cerr << "skipping unsupported file: " << file << "\n";
+    }
+
+    std::cout << std::fixed << std::setprecision(6);
+
+    for (auto& [name, config] : backends) {
+        vad vad{config};
+        if (vad.backend_type() != config.backend_type) {
+            std::cerr << "skipping backend: " << name << "\n";
+            continue;
+        }
+
+        result_t total;
+        for (const auto& samples : corpus) {
+            auto result = run_vad(vad, samples);
+            total.audio_samples += result.audio_samples;
+            total.speech_samples += result.speech_samples;
+            total.vad_time += result.vad_time;
+        }
+
+        auto audio_sec = static_cast<double>(total.audio_samples) / sample_rate;
+        auto speech_sec =
+            static_cast<double>(total.speech_samples) / sample_rate;
+
+        std::cout << name << ": audio=" << audio_sec << "s"
+                  << ", to-decode=" << speech_sec << "s"
+                  << ", decoded-sec-per-audio-sec="
+                  << (audio_sec > 0 ? speech_sec / audio_sec : 0.0)
+                  << ", vad-rtf="
+                  << (audio_sec > 0 ? total.vad_time.count() / audio_sec : 0.0)
+                  << "\n";
+    }
+
+    return 0;
+}
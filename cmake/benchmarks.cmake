@@ -0,0 +1,7 @@
+set(benchmarks vad_bench stt_bench)
+
+add_executable(vad_bench "${benchmarks_dir}/vad_bench.cpp")
+target_link_libraries(vad_bench dsnote_lib)
+
+add_executable(stt_bench "${benchmarks_dir}/stt_bench.cpp")
+target_link_libraries(stt_bench dsnote_lib)
@@ -63,6 +63,13 @@ if(BUILD_WHISPERCPP)
         install(PROGRAMS "${external_lib_dir}/libwhisper-fallback1.so.1" DESTINATION ${lib_install_dir})
         install(PROGRAMS "${external_lib_dir}/libwhisper-fallback1.so" DESTINATION ${lib_install_dir})
     endif()
+    if(BUILD_WHISPERCPP_CPU_VARIANTS)
+        foreach(variant avx512 avxvnni noblas)
+            install(PROGRAMS "${external_lib_dir}/libwhisper-${variant}.so.${whispercpp_ver}" DESTINATION ${lib_install_dir})
+            install(PROGRAMS "${external_lib_dir}/libwhisper-${variant}.so.1" DESTINATION ${lib_install_dir})
+            install(PROGRAMS "${external_lib_dir}/libwhisper-${variant}.so" DESTINATION ${lib_install_dir})
+        endforeach()
+    endif()
     if(BUILD_WHISPERCPP_CLBLAST)
         set(whispercpp_clblast_ver "1.6.2")
         set(clblast_ver "1.6.3")
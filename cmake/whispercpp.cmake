@@ -363,8 +363,98 @@ if(BUILD_OPENBLAS)
     ExternalProject_Add_StepDependencies(whispercppopenblas configure openblas)
 endif()
 
+if(BUILD_WHISPERCPP_CPU_VARIANTS)
+    # without blas, matrix multiplications are done by ggml native kernels
+    ExternalProject_Add(whispercppavx512
+        SOURCE_DIR ${external_dir}/whispercppavx512
+        BINARY_DIR ${PROJECT_BINARY_DIR}/external/whispercppavx512
+        INSTALL_DIR ${PROJECT_BINARY_DIR}/external
+        URL "${whispercpp_source_url}"
+        URL_HASH SHA256=${whispercpp_checksum}
+        PATCH_COMMAND patch --batch --unified -p1 --directory=<SOURCE_DIR>
+                    -i ${whispercpp_patch_file} ||
+                        echo "patch cmd failed, likely already patched"
+        CONFIGURE_COMMAND ${CMAKE_COMMAND} -E env PKG_CONFIG_PATH=$ENV{PKG_CONFIG_PATH}
+            ${CMAKE_COMMAND} -S <SOURCE_DIR> -B <BINARY_DIR>
+            -DCMAKE_BUILD_TYPE=Release
+            -DCMAKE_INSTALL_PREFIX=<INSTALL_DIR>
+            -DCMAKE_PREFIX_PATH=<INSTALL_DIR>
+            -DCMAKE_INSTALL_LIBDIR=lib
+            -DGGML_NATIVE=OFF
+            -DGGML_BLAS=OFF
+            -DGGML_AVX=ON -DGGML_AVX2=ON -DGGML_FMA=ON -DGGML_F16C=ON
+            -DGGML_AVX512=ON -DGGML_AVX512_VNNI=ON
+            -DBUILD_SHARED_LIBS=ON
+            -DWHISPER_BUILD_TESTS=OFF -DWHISPER_BUILD_EXAMPLES=OFF
+            -DCMAKE_C_FLAGS=${whispercpp_flags} -DCMAKE_CXX_FLAGS=${whispercpp_flags}
+            -DCMAKE_INSTALL_RPATH=${rpath_install_dir}
+            -DWHISPER_TARGET_NAME=whisper-avx512
+        BUILD_ALWAYS False
+    )
+
+    ExternalProject_Add(whispercppavxvnni
+        SOURCE_DIR ${external_dir}/whispercppavxvnni
+        BINARY_DIR ${PROJECT_BINARY_DIR}/external/whispercppavxvnni
+        INSTALL_DIR ${PROJECT_BINARY_DIR}/external
+        URL "${whispercpp_source_url}"
+        URL_HASH SHA256=${whispercpp_checksum}
+        PATCH_COMMAND patch --batch --unified -p1 --directory=<SOURCE_DIR>
+                    -i ${whispercpp_patch_file} ||
+                        echo "patch cmd failed, likely already patched"
+        CONFIGURE_COMMAND ${CMAKE_COMMAND} -E env PKG_CONFIG_PATH=$ENV{PKG_CONFIG_PATH}
+            ${CMAKE_COMMAND} -S <SOURCE_DIR> -B <BINARY_DIR>
+            -DCMAKE_BUILD_TYPE=Release
+            -DCMAKE_INSTALL_PREFIX=<INSTALL_DIR>
+            -DCMAKE_PREFIX_PATH=<INSTALL_DIR>
+            -DCMAKE_INSTALL_LIBDIR=lib
+            -DGGML_NATIVE=OFF
+            -DGGML_BLAS=OFF
+            -DGGML_AVX=ON -DGGML_AVX2=ON -DGGML_FMA=ON -DGGML_F16C=ON
+            -DGGML_AVX_VNNI=ON
+            -DBUILD_SHARED_LIBS=ON
+            -DWHISPER_BUILD_TESTS=OFF -DWHISPER_BUILD_EXAMPLES=OFF
+            -DCMAKE_C_FLAGS=${whispercpp_flags} -DCMAKE_CXX_FLAGS=${whispercpp_flags}
+            -DCMAKE_INSTALL_RPATH=${rpath_install_dir}
+            -DWHISPER_TARGET_NAME=whisper-avxvnni
+        BUILD_ALWAYS False
+    )
+
+    ExternalProject_Add(whispercppnoblas
+        SOURCE_DIR ${external_dir}/whispercppnoblas
+        BINARY_DIR ${PROJECT_BINARY_DIR}/external/whispercppnoblas
+        INSTALL_DIR ${PROJECT_BINARY_DIR}/external
+        URL "${whispercpp_source_url}"
+        URL_HASH SHA256=${whispercpp_checksum}
+        PATCH_COMMAND patch --batch --unified -p1 --directory=<SOURCE_DIR>
+                    -i ${whispercpp_patch_file} ||
+                        echo "patch cmd failed, likely already patched"
+        CONFIGURE_COMMAND ${CMAKE_COMMAND} -E env PKG_CONFIG_PATH=$ENV{PKG_CONFIG_PATH}
+            ${CMAKE_COMMAND} -S <SOURCE_DIR> -B <BINARY_DIR>
+            -DCMAKE_BUILD_TYPE=Release
+            -DCMAKE_INSTALL_PREFIX=<INSTALL_DIR>
+            -DCMAKE_PREFIX_PATH=<INSTALL_DIR>
+            -DCMAKE_INSTALL_LIBDIR=lib
+            -DGGML_NATIVE=OFF
+            -DGGML_BLAS=OFF
+            -DGGML_AVX=ON -DGGML_AVX2=ON -DGGML_FMA=ON -DGGML_F16C=ON
+            -DBUILD_SHARED_LIBS=ON
+            -DWHISPER_BUILD_TESTS=OFF -DWHISPER_BUILD_EXAMPLES=OFF
+            -DCMAKE_C_FLAGS=${whispercpp_flags} -DCMAKE_CXX_FLAGS=${whispercpp_flags}
+            -DCMAKE_INSTALL_RPATH=${rpath_install_dir}
+            -DWHISPER_TARGET_NAME=whisper-noblas
+        BUILD_ALWAYS False
+    )
+
+    ExternalProject_Add_StepDependencies(whispercppopenblas install whispercppnoblas)
+    ExternalProject_Add_StepDependencies(whispercppnoblas install whispercppavxvnni)
+    ExternalProject_Add_StepDependencies(whispercppavxvnni install whispercppavx512)
+
+    list(APPEND deps whispercppavx512 whispercppavxvnni whispercppnoblas)
+endif(BUILD_WHISPERCPP_CPU_VARIANTS)
+
 # make sequential rather than parallel installing of different types of whisper.cpp
-# order: whispercppopenblas => whispercppfallback1 => whispercppfallback => whispercppvulkan
+# order: whispercppavx512 => whispercppavxvnni => whispercppnoblas (only with BUILD_WHISPERCPP_CPU_VARIANTS)
+#        => whispercppopenblas => whispercppfallback1 => whispercppfallback => whispercppvulkan
 #        => whispercppclblast => whispercppcublas => whispercpphipblas => whispercppopenvino
 ExternalProject_Add_StepDependencies(whispercppfallback install whispercppfallback1)
 ExternalProject_Add_StepDependencies(whispercppfallback1 install whispercppopenblas)
@@ -17,6 +17,7 @@
 
 #include "dbus_application_inf.h"
 #include "dbus_dsnote_inf.h"
+#include "dbus_speech_inf.h"
 
 app_server::app_server(const cmd::options &options, QObject *parent)
     : QObject{parent},
@@ -127,6 +128,42 @@ int app_server::request_another_instance(const cmd::options &options) {
         if (options.state_scope_to_print_flag & cmd::scope_task) {
             fmt::print("Task state:\n\t{}\n", iface.taskState());
         }
+        if (options.state_scope_to_print_flag & cmd::scope_stt_stats) {
+            OrgMkiolSpeechInterface speech_iface{
+                DBUS_SPEECH_SERVICE_NAME, DBUS_SPEECH_SERVICE_PATH,
+                QDBusConnection::sessionBus()};
+            speech_iface.setTimeout(DBUS_TIMEOUT_MS);
+
+            auto reply = speech_iface.SttPipelineStats();
+            reply.waitForFinished();
+
+            // speech object is registered only when service runs separately
+            if (reply.isError()) {
+                fmt::print(stderr,
+                           "Failed to get STT pipeline stats. Speech service "
+                           "is not available: {}\n",
+                           reply.error().message().toStdString());
+                return 1;
+            }
+
+            const auto stats = reply.value();
+
+            fmt::print("STT pipeline stats (us):\n");
+            for (auto it = stats.cbegin(); it != stats.cend(); ++it) {
+                auto stage = qdbus_cast<QVariantMap>(
+                    it.value().value<QDBusArgument>());
+                fmt::print(
+                    "\t{}: count={}, mean={}, p50={}, p90={}, p99={}, "
+                    "max={}\n",
+                    it.key().toStdString(),
+                    stage.value("count").toULongLong(),
+                    stage.value("mean_us").toULongLong(),
+                    stage.value("p50_us").toULongLong(),
+                    stage.value("p90_us").toULongLong(),
+                    stage.value("p99_us").toULongLong(),
+                    stage.value("max_us").toULongLong());
+            }
+        }
 
         auto max_id_size = [](const QVariantList &models) {
             return std::accumulate(
@@ -62,6 +62,9 @@ class app_server : public QObject {
         QStringLiteral(APP_DBUS_APP_SERVICE)};
     inline static const QString DBUS_SERVICE_PATH{
         QStringLiteral(APP_DBUS_APP_PATH)};
+    inline static const QString DBUS_SPEECH_SERVICE_NAME{
+        QStringLiteral(APP_DBUS_SPEECH_SERVICE)};
+    inline static const QString DBUS_SPEECH_SERVICE_PATH{QStringLiteral("/")};
     static const int DBUS_TIMEOUT_MS = 10000;  // 10s
 
     enum class action_error_code_t {
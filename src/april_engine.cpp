@@ -126,10 +126,9 @@ stt_engine::samples_process_result_t april_engine::process_buff() {
         m_segments.clear();
     }
 
-    m_denoiser.process(m_in_buf.buf.data(), m_in_buf.size);
+    denoise_in_buf();
 
-    const auto& vad_buf =
-        m_vad.remove_silence(m_in_buf.buf.data(), m_in_buf.size);
+    const auto& vad_buf = remove_silence_from_in_buf();
 
     bool vad_status = !vad_buf.empty();
 
@@ -244,9 +243,13 @@ void april_engine::decode_handler(void* user_data, AprilResultType result_type,
 void april_engine::decode_speech(april_buf_t& buf, bool eof) {
     LOGD("speech decoding started");
 
+    auto decoding_start = std::chrono::steady_clock::now();
+
     if (buf.size() > 0) aas_feed_pcm16(m_session, buf.data(), buf.size());
     if (eof) aas_flush(m_session);
 
+    record_stage(stage_t::inference, decoding_start);
+
 #ifdef DEBUG
     LOGD("speech decoded: text=" << m_result);
 #else
@@ -295,8 +298,7 @@ void april_engine::decode_speech(april_buf_t& buf, bool eof) {
         rtrim(m_result_prev_segment);
 
         if (m_punctuator) {
-            m_result_prev_segment =
-                m_punctuator->process(m_result_prev_segment);
+            m_result_prev_segment = punctuate(m_result_prev_segment);
         } else {
             text_tools::restore_caps(m_result_prev_segment);
         }
@@ -321,7 +323,7 @@ void april_engine::decode_speech(april_buf_t& buf, bool eof) {
         rtrim(result);
 
         if (m_punctuator) {
-            result = m_punctuator->process(result);
+            result = punctuate(result);
         } else {
             text_tools::restore_caps(result);
         }
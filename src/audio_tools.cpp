@@ -0,0 +1,334 @@
+/* Copyright (C) 2025 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "audio_tools.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define AUDIO_TOOLS_X86
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AUDIO_TOOLS_NEON
+#endif
+
+#ifdef AUDIO_TOOLS_X86
+#include "cpu_tools.hpp"
+#endif
+
+namespace audio_tools {
+// 1/32768 is a power of two, so multiplying is exact like dividing
+static constexpr float s16_scale = 1.0F / 32768.0F;
+static constexpr int s16_max = std::numeric_limits<int16_t>::max();
+static constexpr int s16_min = std::numeric_limits<int16_t>::min();
+
+static void s16_to_f32_scalar(const int16_t* in, size_t size, float* out,
+                              float scale) {
+    for (size_t i = 0; i < size; ++i)
+        out[i] = static_cast<float>(in[i]) * scale;
+}
+
+void s16_to_f32_scalar(const int16_t* in, size_t size, float* out) {
+    s16_to_f32_scalar(in, size, out, s16_scale);
+}
+
+void s16_to_f32_unscaled_scalar(const int16_t* in, size_t size, float* out) {
+    s16_to_f32_scalar(in, size, out, 1.0F);
+}
+
+void f32_unscaled_to_s16_scalar(const float* in, size_t size, int16_t* out) {
+    for (size_t i = 0; i < size; ++i)
+        out[i] = static_cast<int16_t>(std::clamp(
+            in[i], static_cast<float>(s16_min), static_cast<float>(s16_max)));
+}
+
+int peak_s16_scalar(const int16_t* in, size_t size) {
+    int peak = 0;
+    for (size_t i = 0; i < size; ++i)
+        peak = std::max(peak, std::abs(static_cast<int>(in[i])));
+    return peak;
+}
+
+void apply_gain_s16_scalar(int16_t* buf, size_t size, int gain_q10) {
+    for (size_t i = 0; i < size; ++i)
+        buf[i] = static_cast<int16_t>(
+            std::clamp(buf[i] * gain_q10 >> 10, s16_min, s16_max));
+}
+
+#ifdef AUDIO_TOOLS_X86
+static void s16_to_f32_sse2(const int16_t* in, size_t size, float* out,
+                            float scale) {
+    const auto vscale = _mm_set1_ps(scale);
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        // sign-extend to 32 bits by shifting high half of interleaved pairs
+        auto lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        auto hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), vscale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vscale));
+    }
+
+    s16_to_f32_scalar(in + i, size - i, out + i, scale);
+}
+
+__attribute__((target("avx2"))) static void s16_to_f32_avx2(const int16_t* in,
+                                                              size_t size,
+                                                              float* out,
+                                                              float scale) {
+    const auto vscale = _mm256_set1_ps(scale);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        auto lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v));
+        auto hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1));
+        _mm256_storeu_ps(out + i,
+                         _mm256_mul_ps(_mm256_cvtepi32_ps(lo), vscale));
+        _mm256_storeu_ps(out + i + 8,
+                         _mm256_mul_ps(_mm256_cvtepi32_ps(hi), vscale));
+    }
+
+    s16_to_f32_sse2(in + i, size - i, out + i, scale);
+}
+
+static void f32_unscaled_to_s16_sse2(const float* in, size_t size,
+                                     int16_t* out) {
+    const auto vmax = _mm_set1_ps(static_cast<float>(s16_max));
+    const auto vmin = _mm_set1_ps(static_cast<float>(s16_min));
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        auto lo = _mm_cvttps_epi32(
+            _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), vmin), vmax));
+        auto hi = _mm_cvttps_epi32(
+            _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), vmin), vmax));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm_packs_epi32(lo, hi));
+    }
+
+    f32_unscaled_to_s16_scalar(in + i, size - i, out + i);
+}
+
+static int peak_s16_sse2(const int16_t* in, size_t size) {
+    auto vmax = _mm_setzero_si128();
+    auto vmin = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        vmax = _mm_max_epi16(vmax, v);
+        vmin = _mm_min_epi16(vmin, v);
+    }
+
+    alignas(16) int16_t maxs[8];
+    alignas(16) int16_t mins[8];
+    _mm_store_si128(reinterpret_cast<__m128i*>(maxs), vmax);
+    _mm_store_si128(reinterpret_cast<__m128i*>(mins), vmin);
+
+    int peak = peak_s16_scalar(in + i, size - i);
+    for (int j = 0; j < 8; ++j)
+        peak = std::max({peak, static_cast<int>(maxs[j]),
+                         -static_cast<int>(mins[j])});
+
+    return peak;
+}
+
+__attribute__((target("avx2"))) static void apply_gain_s16_avx2(
+    int16_t* buf, size_t size, int gain_q10) {
+    const auto vgain = _mm256_set1_epi32(gain_q10);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf + i));
+        auto lo = _mm256_srai_epi32(
+            _mm256_mullo_epi32(
+                _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v)), vgain),
+            10);
+        auto hi = _mm256_srai_epi32(
+            _mm256_mullo_epi32(
+                _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1)), vgain),
+            10);
+        // pack saturates, permute restores order after in-lane packing
+        auto packed =
+            _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(buf + i), packed);
+    }
+
+    apply_gain_s16_scalar(buf + i, size - i, gain_q10);
+}
+
+static bool has_avx2() {
+    static const bool avx2 = cpu_tools::cpuinfo().feature_flags &
+                             cpu_tools::feature_flags_t::avx2;
+    return avx2;
+}
+#endif
+
+#ifdef AUDIO_TOOLS_NEON
+static void s16_to_f32_neon(const int16_t* in, size_t size, float* out,
+                            float scale) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        auto v = vld1q_s16(in + i);
+        auto lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+        auto hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+        vst1q_f32(out + i, vmulq_n_f32(lo, scale));
+        vst1q_f32(out + i + 4, vmulq_n_f32(hi, scale));
+    }
+
+    s16_to_f32_scalar(in + i, size - i, out + i, scale);
+}
+
+static void f32_unscaled_to_s16_neon(const float* in, size_t size,
+                                     int16_t* out) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        // conversion truncates toward zero and saturates
+        auto lo = vqmovn_s32(vcvtq_s32_f32(vld1q_f32(in + i)));
+        auto hi = vqmovn_s32(vcvtq_s32_f32(vld1q_f32(in + i + 4)));
+        vst1q_s16(out + i, vcombine_s16(lo, hi));
+    }
+
+    f32_unscaled_to_s16_scalar(in + i, size - i, out + i);
+}
+
+static void apply_gain_s16_neon(int16_t* buf, size_t size, int gain_q10) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        auto v = vld1q_s16(buf + i);
+        auto lo = vshrq_n_s32(vmulq_n_s32(vmovl_s16(vget_low_s16(v)), gain_q10),
+                              10);
+        auto hi = vshrq_n_s32(
+            vmulq_n_s32(vmovl_s16(vget_high_s16(v)), gain_q10), 10);
+        vst1q_s16(buf + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+
+    apply_gain_s16_scalar(buf + i, size - i, gain_q10);
+}
+#endif
+
+static void s16_to_f32(const int16_t* in, size_t size, float* out,
+                       float scale) {
+#if defined(AUDIO_TOOLS_X86)
+    if (has_avx2())
+        s16_to_f32_avx2(in, size, out, scale);
+    else
+        s16_to_f32_sse2(in, size, out, scale);
+#elif defined(AUDIO_TOOLS_NEON)
+    s16_to_f32_neon(in, size, out, scale);
+#else
+    s16_to_f32_scalar(in, size, out, scale);
+#endif
+}
+
+void s16_to_f32(const int16_t* in, size_t size, float* out) {
+    s16_to_f32(in, size, out, s16_scale);
+}
+
+void s16_to_f32_unscaled(const int16_t* in, size_t size, float* out) {
+    s16_to_f32(in, size, out, 1.0F);
+}
+
+void append_s16_as_f32(const int16_t* in, size_t size,
+                       std::vector<float>& out) {
+    auto offset = out.size();
+    out.resize(offset + size);
+    s16_to_f32(in, size, out.data() + offset);
+}
+
+void f32_unscaled_to_s16(const float* in, size_t size, int16_t* out) {
+#if defined(AUDIO_TOOLS_X86)
+    f32_unscaled_to_s16_sse2(in, size, out);
+#elif defined(AUDIO_TOOLS_NEON)
+    f32_unscaled_to_s16_neon(in, size, out);
+#else
+    f32_unscaled_to_s16_scalar(in, size, out);
+#endif
+}
+
+int peak_s16(const int16_t* in, size_t size) {
+#if defined(AUDIO_TOOLS_X86)
+    return peak_s16_sse2(in, size);
+#else
+    return peak_s16_scalar(in, size);
+#endif
+}
+
+void apply_gain_s16(int16_t* buf, size_t size, int gain_q10) {
+#if defined(AUDIO_TOOLS_X86)
+    if (has_avx2())
+        apply_gain_s16_avx2(buf, size, gain_q10);
+    else
+        apply_gain_s16_scalar(buf, size, gain_q10);
+#elif defined(AUDIO_TOOLS_NEON)
+    apply_gain_s16_neon(buf, size, gain_q10);
+#else
+    apply_gain_s16_scalar(buf, size, gain_q10);
+#endif
+}
+
+std::optional<std::vector<int16_t>> read_wav_s16(const std::string& file,
+                                                 uint32_t sample_rate) {
+    std::ifstream is{file, std::ios::binary};
+    if (!is) return std::nullopt;
+
+    auto read_u32 = [&is] {
+        uint32_t value = 0;
+        is.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    };
+    auto read_u16 = [&is] {
+        uint16_t value = 0;
+        is.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    };
+
+    char id[4];
+    is.read(id, 4);
+    if (!is || std::memcmp(id, "RIFF", 4) != 0) return std::nullopt;
+    read_u32();
+    is.read(id, 4);
+    if (!is || std::memcmp(id, "WAVE", 4) != 0) return std::nullopt;
+
+    bool fmt_ok = false;
+
+    while (is.read(id, 4)) {
+        auto size = read_u32();
+
+        if (std::memcmp(id, "fmt ", 4) == 0) {
+            auto format = read_u16();
+            auto channels = read_u16();
+            auto rate = read_u32();
+            read_u32();
+            read_u16();
+            auto bits = read_u16();
+            is.ignore(size - 16);
+
+            fmt_ok = format == 1 && channels == 1 && rate == sample_rate &&
+                     bits == 16;
+            if (!fmt_ok) return std::nullopt;
+        } else if (std::memcmp(id, "data", 4) == 0 && fmt_ok) {
+            std::vector<int16_t> samples(size / sizeof(int16_t));
+            is.read(reinterpret_cast<char*>(samples.data()),
+                    samples.size() * sizeof(int16_t));
+            samples.resize(is.gcount() / sizeof(int16_t));
+            return samples;
+        } else {
+            is.ignore(size + (size & 1));
+        }
+    }
+
+    return std::nullopt;
+}
+}  // namespace audio_tools
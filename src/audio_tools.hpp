@@ -0,0 +1,46 @@
+/* Copyright (C) 2025 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AUDIO_TOOLS_HPP
+#define AUDIO_TOOLS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace audio_tools {
+// converts s16 samples to f32 in range [-1, 1)
+void s16_to_f32(const int16_t* in, size_t size, float* out);
+void s16_to_f32_scalar(const int16_t* in, size_t size, float* out);
+
+// appends converted samples to the end of out
+void append_s16_as_f32(const int16_t* in, size_t size, std::vector<float>& out);
+
+// converts without scaling, f32 values keep s16 range
+void s16_to_f32_unscaled(const int16_t* in, size_t size, float* out);
+void s16_to_f32_unscaled_scalar(const int16_t* in, size_t size, float* out);
+
+// truncates toward zero and saturates to s16 range
+void f32_unscaled_to_s16(const float* in, size_t size, int16_t* out);
+void f32_unscaled_to_s16_scalar(const float* in, size_t size, int16_t* out);
+
+// max absolute sample value, abs(-32768) is 32768
+int peak_s16(const int16_t* in, size_t size);
+int peak_s16_scalar(const int16_t* in, size_t size);
+
+// multiplies samples by gain in Q10 format with saturation to s16 range
+void apply_gain_s16(int16_t* buf, size_t size, int gain_q10);
+void apply_gain_s16_scalar(int16_t* buf, size_t size, int gain_q10);
+
+// reads samples of mono s16 pcm wav file with given sample rate
+std::optional<std::vector<int16_t>> read_wav_s16(const std::string& file,
+                                                 uint32_t sample_rate);
+}  // namespace audio_tools
+
+#endif  // AUDIO_TOOLS_HPP
@@ -23,7 +23,8 @@ enum role_flag : uint8_t {
 enum scope_flag : uint8_t {
     scope_none = 0,
     scope_general = 1 << 0,
-    scope_task = 1 << 1
+    scope_task = 1 << 1,
+    scope_stt_stats = 1 << 2
 };
 
 struct options {
@@ -45,6 +46,7 @@ struct options {
     QStringList files;
     QString log_file;
     QString output_file;
+    QString calibration_file;
 };
 }  // namespace cmd
 
@@ -7,9 +7,18 @@
 
 #include "cpu_tools.hpp"
 
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <map>
+#include <mutex>
 #include <regex>
+#include <sstream>
 #include <string>
+#include <thread>
 
 #include "logger.hpp"
 
@@ -49,6 +58,32 @@ std::ostream& operator<<(std::ostream& os, cpu_tools::cpuinfo_t cpuinfo) {
         os << "sse4.1, ";
     if (cpuinfo.feature_flags & cpu_tools::feature_flags_t::bmi2)
         os << "bmi2, ";
+    if (cpuinfo.feature_flags & cpu_tools::feature_flags_t::avx512bw)
+        os << "avx512bw, ";
+    if (cpuinfo.feature_flags & cpu_tools::feature_flags_t::avx512dq)
+        os << "avx512dq, ";
+    if (cpuinfo.feature_flags & cpu_tools::feature_flags_t::avx512_vnni)
+        os << "avx512-vnni, ";
+    if (cpuinfo.feature_flags & cpu_tools::feature_flags_t::avx_vnni)
+        os << "avx-vnni, ";
+
+    os << "]";
+
+    return os;
+}
+
+std::ostream& operator<<(std::ostream& os,
+                         const cpu_tools::topology_t& topology) {
+    os << "cores=" << topology.cores.size()
+       << ", performance-cores=" << topology.number_of_performance_cores
+       << ", l2-cache=" << topology.l2_cache_size
+       << ", l3-cache=" << topology.l3_cache_size << ", cpus=[";
+
+    for (const auto& core : topology.cores) {
+        os << "[";
+        for (auto cpu : core) os << cpu << ",";
+        os << "], ";
+    }
 
     os << "]";
 
@@ -117,6 +152,15 @@ cpuinfo_t parse_cpuinfo(std::istream& stream) {
                     cpuinfo.feature_flags |= feature_flags_t::sse4_1;
                 if (pieces_match[2].str().find("bmi2") != std::string::npos)
                     cpuinfo.feature_flags |= feature_flags_t::bmi2;
+                if (pieces_match[2].str().find("avx512bw") != std::string::npos)
+                    cpuinfo.feature_flags |= feature_flags_t::avx512bw;
+                if (pieces_match[2].str().find("avx512dq") != std::string::npos)
+                    cpuinfo.feature_flags |= feature_flags_t::avx512dq;
+                if (pieces_match[2].str().find("avx512_vnni") !=
+                    std::string::npos)
+                    cpuinfo.feature_flags |= feature_flags_t::avx512_vnni;
+                if (pieces_match[2].str().find("avx_vnni") != std::string::npos)
+                    cpuinfo.feature_flags |= feature_flags_t::avx_vnni;
 
                 LOGD("cpu flags: " << pieces_match[2].str());
                 flags_done = true;
@@ -130,4 +174,217 @@ cpuinfo_t parse_cpuinfo(std::istream& stream) {
 
     return cpuinfo;
 }
+
+std::vector<unsigned int> parse_cpu_list(const std::string& list) {
+    std::vector<unsigned int> cpus;
+
+    std::istringstream is{list};
+    for (std::string range; std::getline(is, range, ',');) {
+        try {
+            auto pos = range.find('-');
+            auto first = std::stoul(range.substr(0, pos));
+            auto last = pos == std::string::npos
+                            ? first
+                            : std::stoul(range.substr(pos + 1));
+            for (auto cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(static_cast<unsigned int>(cpu));
+        } catch (const std::logic_error&) {
+            // not a number, e.g. trailing new line
+        }
+    }
+
+    return cpus;
+}
+
+static std::string read_sysfs_value(const std::string& file) {
+    std::ifstream is{file};
+    std::string value;
+    std::getline(is, value);
+    return value;
+}
+
+static size_t parse_cache_size(const std::string& size) {
+    try {
+        size_t pos = 0;
+        auto value = std::stoul(size, &pos);
+        if (pos < size.size() && size[pos] == 'K') return value * 1024;
+        if (pos < size.size() && size[pos] == 'M') return value * 1024 * 1024;
+        return value;
+    } catch (const std::logic_error&) {
+        return 0;
+    }
+}
+
+topology_t parse_topology(const std::string& sysfs_cpu_dir) {
+    topology_t topology;
+
+    auto online = parse_cpu_list(read_sysfs_value(sysfs_cpu_dir + "/online"));
+
+    // siblings list => (performance rank, logical cpus)
+    std::map<std::string, std::pair<unsigned long, std::vector<unsigned int>>>
+        cores;
+
+    for (auto cpu : online) {
+        auto cpu_dir = sysfs_cpu_dir + "/cpu" + std::to_string(cpu);
+
+        auto siblings = read_sysfs_value(cpu_dir + "/topology/core_cpus_list");
+        if (siblings.empty())
+            siblings =
+                read_sysfs_value(cpu_dir + "/topology/thread_siblings_list");
+        if (siblings.empty()) siblings = std::to_string(cpu);
+
+        // arm big.little exposes capacity, x86 hybrid differs in max freq
+        unsigned long rank = 0;
+        try {
+            auto capacity = read_sysfs_value(cpu_dir + "/cpu_capacity");
+            rank = capacity.empty()
+                       ? std::stoul(read_sysfs_value(
+                             cpu_dir + "/cpufreq/cpuinfo_max_freq"))
+                       : std::stoul(capacity);
+        } catch (const std::logic_error&) {
+        }
+
+        auto& core = cores[siblings];
+        core.first = std::max(core.first, rank);
+        core.second.push_back(cpu);
+
+        for (unsigned int i = 0;; ++i) {
+            auto index_dir = cpu_dir + "/cache/index" + std::to_string(i);
+            auto level = read_sysfs_value(index_dir + "/level");
+            if (level.empty()) break;
+            auto size = parse_cache_size(read_sysfs_value(index_dir + "/size"));
+            if (level == "2")
+                topology.l2_cache_size = std::max(topology.l2_cache_size, size);
+            else if (level == "3")
+                topology.l3_cache_size = std::max(topology.l3_cache_size, size);
+        }
+    }
+
+    std::vector<std::pair<unsigned long, std::vector<unsigned int>>> sorted;
+    for (auto& [_, core] : cores) sorted.push_back(std::move(core));
+
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const auto& lhs, const auto& rhs) {
+                         if (lhs.first != rhs.first)
+                             return lhs.first > rhs.first;
+                         return lhs.second.front() < rhs.second.front();
+                     });
+
+    auto max_rank = sorted.empty() ? 0 : sorted.front().first;
+
+    for (auto& [rank, cpus] : sorted) {
+        // small max freq differences between performance cores are expected
+        if (rank * 100 >= max_rank * 85) ++topology.number_of_performance_cores;
+        topology.cores.push_back(std::move(cpus));
+    }
+
+    return topology;
+}
+
+topology_t topology() {
+    static auto topology = [] {
+        auto topology = parse_topology("/sys/devices/system/cpu");
+
+        if (topology.cores.empty()) {
+            LOGW("can't read cpu topology");
+
+            // each logical cpu as separate core
+            auto n = std::max(1U, std::thread::hardware_concurrency());
+            for (unsigned int cpu = 0; cpu < n; ++cpu)
+                topology.cores.push_back({cpu});
+            topology.number_of_performance_cores = n;
+        }
+
+        LOGD("cpu topology: " << topology);
+
+        return topology;
+    }();
+
+    return topology;
+}
+
+static std::mutex budget_mtx;
+static std::vector<bool> budget_used_cores;
+static std::atomic_bool thread_pinning = false;
+
+void set_thread_pinning(bool enabled) { thread_pinning = enabled; }
+
+thread_lease acquire_threads(unsigned int max_threads) {
+    const auto& topo = topology();
+
+    std::lock_guard lock{budget_mtx};
+
+    budget_used_cores.resize(topo.cores.size(), false);
+
+    thread_lease lease;
+
+    auto take = [&](size_t first, size_t last) {
+        for (auto i = first; i < last && lease.m_cores.size() < max_threads;
+             ++i) {
+            if (budget_used_cores[i]) continue;
+            budget_used_cores[i] = true;
+            lease.m_cores.push_back(static_cast<unsigned int>(i));
+        }
+    };
+
+    // slow cores only when no performance core is free
+    take(0, topo.number_of_performance_cores);
+    if (lease.m_cores.empty())
+        take(topo.number_of_performance_cores, topo.cores.size());
+
+    // all cores are taken, share with others
+    lease.m_threads = std::max<unsigned int>(
+        1, static_cast<unsigned int>(lease.m_cores.size()));
+
+    LOGD("threads acquired: " << lease.m_threads << "/" << max_threads);
+
+    return lease;
+}
+
+thread_lease::thread_lease(thread_lease&& other) noexcept
+    : m_cores{std::move(other.m_cores)}, m_threads{other.m_threads} {
+    other.m_cores.clear();
+    other.m_threads = 0;
+}
+
+thread_lease& thread_lease::operator=(thread_lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        m_cores = std::move(other.m_cores);
+        m_threads = other.m_threads;
+        other.m_cores.clear();
+        other.m_threads = 0;
+    }
+
+    return *this;
+}
+
+thread_lease::~thread_lease() { release(); }
+
+void thread_lease::release() {
+    if (!m_cores.empty()) {
+        std::lock_guard lock{budget_mtx};
+        for (auto core : m_cores) budget_used_cores.at(core) = false;
+        m_cores.clear();
+    }
+
+    m_threads = 0;
+}
+
+void thread_lease::pin_current_thread() const {
+    if (!thread_pinning || m_cores.empty()) return;
+
+    const auto& topo = topology();
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    // one thread per physical core, smt siblings stay free
+    for (auto core : m_cores) CPU_SET(topo.cores.at(core).front(), &set);
+
+    if (auto ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        ret != 0) {
+        LOGW("failed to pin thread: " << ret);
+    }
+}
 }  // namespace cpu_tools
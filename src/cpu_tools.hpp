@@ -8,8 +8,11 @@
 #ifndef CPU_TOOLS_CPP
 #define CPU_TOOLS_CPP
 
+#include <cstddef>
 #include <iostream>
 #include <istream>
+#include <string>
+#include <vector>
 
 namespace cpu_tools {
 enum class arch_t { unknown, x86_64, arm32, arm64 };
@@ -23,7 +26,11 @@ enum feature_flags_t : unsigned int {
     f16c = 1U << 4U,
     asimd = 1U << 5U,
     sse4_1 = 1U << 6U,
-    bmi2 = 1U << 7U
+    bmi2 = 1U << 7U,
+    avx512bw = 1U << 8U,
+    avx512dq = 1U << 9U,
+    avx512_vnni = 1U << 10U,
+    avx_vnni = 1U << 11U
 };
 
 struct cpuinfo_t {
@@ -36,12 +43,57 @@ struct cpuinfo_t {
     }
 };
 
+struct topology_t {
+    // logical cpus of each physical core, performance cores first
+    std::vector<std::vector<unsigned int>> cores;
+    unsigned int number_of_performance_cores = 0;
+    size_t l2_cache_size = 0;  // bytes
+    size_t l3_cache_size = 0;  // bytes
+};
+
+// physical cores given to engine threads, returned to budget in dtor
+class thread_lease {
+   public:
+    thread_lease() = default;
+    thread_lease(thread_lease&& other) noexcept;
+    thread_lease& operator=(thread_lease&& other) noexcept;
+    thread_lease(const thread_lease&) = delete;
+    thread_lease& operator=(const thread_lease&) = delete;
+    ~thread_lease();
+
+    // number of threads engine should use, at least 1 for acquired lease
+    // (also when no core was free), 0 only for default constructed one
+    inline auto threads() const { return m_threads; }
+    // true when no core was free and threads are shared with others
+    inline auto shared() const { return m_cores.empty(); }
+    // restricts current thread and threads it creates to leased cores
+    void pin_current_thread() const;
+
+   private:
+    friend thread_lease acquire_threads(unsigned int max_threads);
+
+    std::vector<unsigned int> m_cores;
+    unsigned int m_threads = 0;
+
+    void release();
+};
+
 cpuinfo_t cpuinfo();
 cpuinfo_t parse_cpuinfo(std::istream& stream);
+topology_t topology();
+topology_t parse_topology(const std::string& sysfs_cpu_dir);
+std::vector<unsigned int> parse_cpu_list(const std::string& list);
 arch_t arch();
+
+// takes up to max_threads free physical cores from the process-wide budget,
+// so engines running at the same time don't share cores
+thread_lease acquire_threads(unsigned int max_threads);
+void set_thread_pinning(bool enabled);
 }  // namespace cpu_tools
 
 std::ostream& operator<<(std::ostream& os, cpu_tools::arch_t arch);
 std::ostream& operator<<(std::ostream& os, cpu_tools::cpuinfo_t cpuinfo);
+std::ostream& operator<<(std::ostream& os,
+                         const cpu_tools::topology_t& topology);
 
 #endif // CPU_TOOLS_CPP
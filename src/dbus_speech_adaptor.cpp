@@ -267,6 +267,14 @@ double SpeechAdaptor::SttGetFileTranscribeProgress(int task)
     return progress;
 }
 
+QVariantMap SpeechAdaptor::SttPipelineStats()
+{
+    // handle method call org.mkiol.Speech.SttPipelineStats
+    QVariantMap stats;
+    QMetaObject::invokeMethod(parent(), "SttPipelineStats", Q_RETURN_ARG(QVariantMap, stats));
+    return stats;
+}
+
 int SpeechAdaptor::SttStartListen(int mode, const QString &lang, const QString &out_lang)
 {
     // handle method call org.mkiol.Speech.SttStartListen
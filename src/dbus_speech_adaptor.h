@@ -179,6 +179,10 @@ class SpeechAdaptor: public QDBusAbstractAdaptor
 "      <arg direction=\"in\" type=\"i\" name=\"task\"/>\n"
 "      <arg direction=\"out\" type=\"d\" name=\"progress\"/>\n"
 "    </method>\n"
+"    <method name=\"SttPipelineStats\">\n"
+"      <annotation value=\"QVariantMap\" name=\"org.qtproject.QtDBus.QtTypeName.Out0\"/>\n"
+"      <arg direction=\"out\" type=\"a{sv}\" name=\"stats\"/>\n"
+"    </method>\n"
 "    <method name=\"TtsGetSpeechToFileProgress\">\n"
 "      <arg direction=\"in\" type=\"i\" name=\"task\"/>\n"
 "      <arg direction=\"out\" type=\"d\" name=\"progress\"/>\n"
@@ -394,6 +398,7 @@ public Q_SLOTS: // METHODS
     int MntTranslate2(const QString &text, const QString &lang, const QString &out_lang, const QVariantMap &options);
     int Reload();
     double SttGetFileTranscribeProgress(int task);
+    QVariantMap SttPipelineStats();
     int SttStartListen(int mode, const QString &lang, const QString &out_lang);
     int SttStartListen2(int mode, const QString &lang, const QString &out_lang, const QVariantMap &options);
     int SttStopListen(int task);
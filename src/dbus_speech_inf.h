@@ -192,6 +192,12 @@ public Q_SLOTS: // METHODS
         return asyncCallWithArgumentList(QStringLiteral("SttGetFileTranscribeProgress"), argumentList);
     }
 
+    inline QDBusPendingReply<QVariantMap> SttPipelineStats()
+    {
+        QList<QVariant> argumentList;
+        return asyncCallWithArgumentList(QStringLiteral("SttPipelineStats"), argumentList);
+    }
+
     inline QDBusPendingReply<int> SttStartListen(int mode, const QString &lang, const QString &out_lang)
     {
         QList<QVariant> argumentList;
@@ -15,6 +15,7 @@ extern "C" {
 #include <cmath>
 #include <stdexcept>
 
+#include "audio_tools.hpp"
 #include "logger.hpp"
 
 denoiser::denoiser(int sample_rate, unsigned int tasks, uint64_t full_size)
@@ -53,18 +54,14 @@ std::vector<float> denoiser::speech_probs() {
     return m_speech_probs;
 }
 
-// TO-DO: refactor with simd
 void denoiser::normalize_audio(sample_t* audio, size_t size, bool second_pass) {
     int max = std::numeric_limits<sample_t>::max();
-    int min = std::numeric_limits<sample_t>::min();
     int target_gain = max * 0.75;
 
     if (!second_pass && (m_task_flags & task_normalize ||
                          m_task_flags & task_normalize_two_pass)) {
-        for (size_t i = 0; i < size; ++i) {
-            int val = std::abs(audio[i]);
-            if (val > m_normalize_peek) m_normalize_peek = val;
-        }
+        m_normalize_peek =
+            std::max(m_normalize_peek, audio_tools::peak_s16(audio, size));
     }
 
     if (m_task_flags & task_normalize || second_pass) {
@@ -80,9 +77,7 @@ void denoiser::normalize_audio(sample_t* audio, size_t size, bool second_pass) {
             return new_gain;
         }();
 
-        for (size_t i = 0; i < size; ++i)
-            audio[i] = static_cast<sample_t>(
-                std::clamp(audio[i] * new_gain >> 10, min, max));
+        audio_tools::apply_gain_s16(audio, size, new_gain);
 
         if (m_task_flags & task_normalize) m_normalize_peek = 1;
     }
@@ -114,14 +109,13 @@ void denoiser::process(sample_t* buf, size_t size) {
             size_t samples = end - cur;
 
             if (samples >= frame.size()) {
-                for (size_t i = 0; i < frame.size(); ++i) frame[i] = cur[i];
                 samples = frame.size();
             } else {
-                for (size_t i = 0; i < samples; ++i) frame[i] = cur[i];
-                for (size_t i = 0; i < frame.size() - samples; ++i)
-                    frame[i] = 0.0;
+                std::fill(frame.begin() + samples, frame.end(), 0.0F);
             }
 
+            audio_tools::s16_to_f32_unscaled(cur, samples, frame.data());
+
             auto prob =
                 rnnoise_process_frame(m_state, frame.data(), frame.data());
 
@@ -138,11 +132,12 @@ void denoiser::process(sample_t* buf, size_t size) {
 
             if (m_task_flags & task_denoise_hard) {
                 if (prob < 0.1)
-                    for (size_t i = 0; i < samples; ++i) cur[i] = 0;
+                    std::fill(cur, cur + samples, 0);
                 else
-                    for (size_t i = 0; i < samples; ++i) cur[i] = frame[i];
+                    audio_tools::f32_unscaled_to_s16(frame.data(), samples,
+                                                     cur);
             } else if (m_task_flags & task_denoise) {
-                for (size_t i = 0; i < samples; ++i) cur[i] = frame[i];
+                audio_tools::f32_unscaled_to_s16(frame.data(), samples, cur);
             }
 
             cur += samples;
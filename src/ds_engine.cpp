@@ -193,10 +193,9 @@ stt_engine::samples_process_result_t ds_engine::process_buff() {
         m_decoded_samples = 0;
     }
 
-    m_denoiser.process(m_in_buf.buf.data(), m_in_buf.size);
+    denoise_in_buf();
 
-    const auto& vad_buf =
-        m_vad.remove_silence(m_in_buf.buf.data(), m_in_buf.size);
+    const auto& vad_buf = remove_silence_from_in_buf();
 
     bool vad_status = !vad_buf.empty();
 
@@ -346,6 +345,7 @@ void ds_engine::decode_speech(const ds_buf_t& buf, bool eof) {
 
     if (eof && m_config.text_format == text_format_t::subrip) {
         auto* meta = m_ds_api.STT_FinishStreamWithMetadata(m_ds_stream, 1);
+        record_stage(stage_t::inference, decoding_start);
 
         LOGD("speech decoded");
 
@@ -355,7 +355,7 @@ void ds_engine::decode_speech(const ds_buf_t& buf, bool eof) {
         m_ds_stream = nullptr;
 
         if (m_punctuator) {
-            segments.first = m_punctuator->process(segments.first);
+            segments.first = punctuate(segments.first);
             text_tools::restore_punctuation_in_segments(segments.first,
                                                         segments.second);
         }
@@ -370,6 +370,7 @@ void ds_engine::decode_speech(const ds_buf_t& buf, bool eof) {
     } else {
         auto* cstr = eof ? m_ds_api.STT_FinishStream(m_ds_stream)
                          : m_ds_api.STT_IntermediateDecode(m_ds_stream);
+        record_stage(stage_t::inference, decoding_start);
         std::string result{cstr};
         m_ds_api.STT_FreeString(cstr);
 
@@ -395,7 +396,7 @@ void ds_engine::decode_speech(const ds_buf_t& buf, bool eof) {
             report_stats(m_decoded_samples, m_sample_rate, m_decoding_duration);
         }
 
-        if (m_punctuator) result = m_punctuator->process(result);
+        if (m_punctuator) result = punctuate(result);
 
         if (!m_intermediate_text || m_intermediate_text != result)
             set_intermediate_text(result, m_config.lang);
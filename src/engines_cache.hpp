@@ -0,0 +1,144 @@
+/* Copyright (C) 2025 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef ENGINES_CACHE_HPP
+#define ENGINES_CACHE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <variant>
+
+struct engines_cache_stats_t {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t count = 0;
+    size_t size = 0;
+    size_t max_size = 0;
+};
+
+inline std::ostream& operator<<(std::ostream& os,
+                                const engines_cache_stats_t& stats) {
+    os << "hits=" << stats.hits << ", misses=" << stats.misses
+       << ", evictions=" << stats.evictions << ", count=" << stats.count
+       << ", size=" << stats.size << ", max-size=" << stats.max_size;
+
+    return os;
+}
+
+// LRU cache of stopped engines that keep their models loaded.
+// Total size of cached models is limited by max size (0 disables cache).
+// Engines with the same model key share one loaded model, so its size is
+// counted once.
+template <typename... Engines>
+class engines_cache {
+   public:
+    using entry_engine_t = std::variant<std::unique_ptr<Engines>...>;
+
+    void set_max_size(size_t max_size) {
+        m_stats.max_size = max_size;
+        evict();
+    }
+
+    // returns false when engine was not accepted (it is destroyed then)
+    template <typename T>
+    bool put(std::string key, std::unique_ptr<T> engine, size_t size,
+             std::string model_key = {}) {
+        if (!engine || key.empty() || m_stats.max_size == 0 ||
+            size > m_stats.max_size)
+            return false;
+
+        remove(key);
+
+        m_entries.push_front(entry_t{std::move(key), std::move(engine), size,
+                                     std::move(model_key)});
+        update_size();
+
+        evict();
+
+        return true;
+    }
+
+    template <typename T>
+    std::unique_ptr<T> take(const std::string& key) {
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->key != key) continue;
+
+            auto* engine = std::get_if<std::unique_ptr<T>>(&it->engine);
+            if (engine == nullptr) break;
+
+            auto taken = std::move(*engine);
+            m_entries.erase(it);
+            update_size();
+            ++m_stats.hits;
+
+            return taken;
+        }
+
+        ++m_stats.misses;
+
+        return {};
+    }
+
+    void clear() {
+        m_entries.clear();
+        m_stats.size = 0;
+        m_stats.count = 0;
+    }
+
+    inline auto stats() const { return m_stats; }
+
+   private:
+    struct entry_t {
+        std::string key;
+        entry_engine_t engine;
+        size_t size = 0;
+        std::string model_key;
+    };
+
+    std::list<entry_t> m_entries;  // most recently used first
+    engines_cache_stats_t m_stats;
+
+    void remove(const std::string& key) {
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->key == key) {
+                m_entries.erase(it);
+                update_size();
+                return;
+            }
+        }
+    }
+
+    void evict() {
+        while (!m_entries.empty() && m_stats.size > m_stats.max_size) {
+            m_entries.pop_back();
+            update_size();
+            ++m_stats.evictions;
+        }
+    }
+
+    void update_size() {
+        m_stats.size = 0;
+        m_stats.count = m_entries.size();
+
+        for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+            if (!it->model_key.empty() &&
+                std::any_of(m_entries.cbegin(), it, [&](const auto& entry) {
+                    return entry.model_key == it->model_key;
+                }))
+                continue;
+            m_stats.size += it->size;
+        }
+    }
+};
+
+#endif  // ENGINES_CACHE_HPP
@@ -15,6 +15,7 @@
 #include <cstdlib>
 #include <sstream>
 
+#include "audio_tools.hpp"
 #include "cpu_tools.hpp"
 #include "gpu_tools.hpp"
 #include "logger.hpp"
@@ -26,7 +27,7 @@ using namespace pybind11::literals;
 fasterwhisper_engine::fasterwhisper_engine(config_t config,
                                            callbacks_t call_backs)
     : stt_engine{std::move(config), std::move(call_backs)} {
-    m_speech_buf.reserve(m_speech_max_size);
+    m_speech_buf.reserve(m_speech_max_size + m_in_buf_max_size);
     m_auto_lang = m_config.lang == "auto";
 }
 
@@ -39,8 +40,20 @@ fasterwhisper_engine::~fasterwhisper_engine() {
 void fasterwhisper_engine::stop() {
     stt_engine::stop();
 
+    if (m_worker) {
+        // model is released with worker process
+        m_worker.reset();
+        m_worker_batched = false;
+    }
+
+    if (!m_model) {
+        LOGD("fasterwhisper stopped");
+        return;
+    }
+
     auto task = py_executor::instance()->execute([&]() {
         try {
+            m_batched_pipeline.reset();
             m_model->attr("model").attr("unload_model")();
             m_model.reset();
 
@@ -60,48 +73,95 @@ void fasterwhisper_engine::stop() {
 void fasterwhisper_engine::push_buf_to_whisper_buf(
     const std::vector<in_buf_t::buf_t::value_type>& buf,
     whisper_buf_t& whisper_buf) {
-    // convert s16 to f32 sample format
-    std::transform(buf.cbegin(), buf.cend(), std::back_inserter(whisper_buf),
-                   [](auto sample) {
-                       return static_cast<whisper_buf_t::value_type>(sample) /
-                              32768.0F;
-                   });
+    audio_tools::append_s16_as_f32(buf.data(), buf.size(), whisper_buf);
 }
 
 void fasterwhisper_engine::push_buf_to_whisper_buf(
     in_buf_t::buf_t::value_type* data, in_buf_t::buf_t::size_type size,
     whisper_buf_t& whisper_buf) {
-    // convert s16 to f32 sample format
-    whisper_buf.reserve(whisper_buf.size() + size);
-    for (size_t i = 0; i < size; ++i) {
-        whisper_buf.push_back(static_cast<whisper_buf_t::value_type>(data[i]) /
-                              32768.0F);
-    }
+    audio_tools::append_s16_as_f32(data, size, whisper_buf);
 }
 
-void fasterwhisper_engine::reset_impl() { m_speech_buf.clear(); }
+void fasterwhisper_engine::reset_impl() {
+    m_speech_buf.clear();
+    m_batch_buf.clear();
+    m_batch_clips.clear();
+}
 
 void fasterwhisper_engine::stop_processing_impl() {
     LOGD("fasterwhisper cancel");
-    // not implemented
+    // running decoding is not interrupted (also one already sent to py
+    // worker, stop waits for its reply), only queued one is dropped
+    py_executor::instance()->cancel(m_decode_cancel_token);
 }
 
-void fasterwhisper_engine::start_processing_impl() { create_model(); }
+void fasterwhisper_engine::start_processing_impl() {
+    *m_decode_cancel_token = false;
+    create_model();
+}
+
+int fasterwhisper_engine::threads_to_use() const {
+    return static_cast<int>(
+        m_thread_lease.threads() > 0
+            ? m_thread_lease.threads()
+            : std::min(m_config.cpu_threads,
+                       std::max(1U, std::thread::hardware_concurrency())));
+}
+
+bool fasterwhisper_engine::use_cuda_device() const {
+    return m_config.use_gpu &&
+           ((m_config.gpu_device.api == gpu_api_t::cuda &&
+             gpu_tools::has_cudnn()) ||
+            (m_config.gpu_device.api == gpu_api_t::rocm &&
+             gpu_tools::has_hip()));
+}
+
+bool fasterwhisper_engine::create_model_in_worker() {
+    if (m_worker_failed) return false;
+
+    auto worker = py_executor::instance()->acquire_worker();
+    if (!worker) return false;
+
+    LOGD("creating fasterwhisper model in py worker: pid=" << worker->pid());
+
+    auto use_cuda = use_cuda_device();
+
+    try {
+        auto reply = worker->call(
+            {{"cmd", "load"},
+             {"engine", "fasterwhisper"},
+             {"model", m_config.model_files.model_file},
+             {"device", use_cuda ? "cuda" : "cpu"},
+             {"device_index", use_cuda ? m_config.gpu_device.id : 0},
+             {"cpu_threads", threads_to_use()},
+             {"flash_attention", use_cuda && m_config.gpu_device.flash_attn},
+             {"batch_size", m_config.batch_size}});
+
+        m_worker_batched = reply.value("batched", false);
+        m_worker = std::move(worker);
+
+        return true;
+    } catch (const std::exception& err) {
+        LOGE("failed to create fasterwhisper model in py worker: "
+             << err.what());
+    }
+
+    return false;
+}
 
 void fasterwhisper_engine::create_model() {
-    if (m_model) return;
+    if (m_model || m_worker) return;
 
     LOGD("creating fasterwhisper model");
 
+    if (create_model_in_worker()) {
+        LOGD("fasterwhisper model created in py worker");
+        return;
+    }
+
     auto task = py_executor::instance()->execute([&]() {
-        auto n_threads = static_cast<int>(
-            std::min(m_config.cpu_threads,
-                     std::max(1U, std::thread::hardware_concurrency())));
-        auto use_cuda =
-            m_config.use_gpu && ((m_config.gpu_device.api == gpu_api_t::cuda &&
-                                  gpu_tools::has_cudnn()) ||
-                                 (m_config.gpu_device.api == gpu_api_t::rocm &&
-                                  gpu_tools::has_hip()));
+        auto n_threads = threads_to_use();
+        auto use_cuda = use_cuda_device();
 
         auto use_flash_attn = m_config.gpu_device.flash_attn && [] {
             auto ct2_ver_str = py::module_::import("ctranslate2")
@@ -147,6 +207,18 @@ void fasterwhisper_engine::create_model() {
                     "device_index"_a = use_cuda ? m_config.gpu_device.id : 0,
                     "local_files_only"_a = true, "cpu_threads"_a = n_threads));
             }
+
+            if (m_config.batch_size > 1) {
+                // available from faster-whisper 1.1.0
+                if (py::hasattr(fw, "BatchedInferencePipeline")) {
+                    LOGD("using batch size: " << m_config.batch_size);
+                    m_batched_pipeline.emplace(
+                        fw.attr("BatchedInferencePipeline")("model"_a =
+                                                                *m_model));
+                } else {
+                    LOGW("batched inference is not supported");
+                }
+            }
         };
 
         try {
@@ -197,15 +269,16 @@ stt_engine::samples_process_result_t fasterwhisper_engine::process_buff() {
 
     if (sof) {
         m_speech_buf.clear();
+        m_batch_buf.clear();
+        m_batch_clips.clear();
         m_start_time.reset();
         m_vad.reset();
         reset_segment_counters();
     }
 
-    m_denoiser.process(m_in_buf.buf.data(), m_in_buf.size);
+    denoise_in_buf();
 
-    const auto& vad_buf =
-        m_vad.remove_silence(m_in_buf.buf.data(), m_in_buf.size);
+    const auto& vad_buf = remove_silence_from_in_buf();
 
     bool vad_status = !vad_buf.empty();
 
@@ -273,6 +346,11 @@ stt_engine::samples_process_result_t fasterwhisper_engine::process_buff() {
         if (eof || (m_config.speech_mode == speech_mode_t::manual &&
                     m_speech_detection_status ==
                         speech_detection_status_t::no_speech)) {
+            if (eof && !m_batch_clips.empty() && !m_thread_exit_requested) {
+                set_state(state_t::decoding);
+                decode_batch();
+                set_state(state_t::idle);
+            }
             flush(eof ? flush_t::eof : flush_t::regular);
             free_buf();
             return samples_process_result_t::no_samples_needed;
@@ -298,7 +376,15 @@ stt_engine::samples_process_result_t fasterwhisper_engine::process_buff() {
     m_segment_time_offset += m_segment_time_discarded_before;
     m_segment_time_discarded_before = 0;
 
-    decode_speech(m_speech_buf);
+    if (use_batching()) {
+        push_speech_to_batch();
+        if (eof || m_batch_buf.size() >=
+                       m_config.batch_size * m_batch_chunk_size)
+            decode_batch();
+    } else {
+        decode_speech(m_speech_buf,
+                      {{0, m_speech_buf.size(), m_segment_time_offset}});
+    }
 
     m_segment_time_offset += (m_segment_time_discarded_after +
                               (1000 * m_speech_buf.size() / m_sample_rate));
@@ -323,21 +409,76 @@ stt_engine::samples_process_result_t fasterwhisper_engine::process_buff() {
     return samples_process_result_t::wait_for_samples;
 }
 
-void fasterwhisper_engine::decode_speech(const whisper_buf_t& buf) {
-    LOGD("speech decoding started");
+bool fasterwhisper_engine::use_batching() const {
+    return (m_batched_pipeline || m_worker_batched) && m_config.offline &&
+           m_config.speech_mode == speech_mode_t::automatic;
+}
 
-    create_model();
+void fasterwhisper_engine::push_speech_to_batch() {
+    m_batch_clips.push_back(
+        {m_batch_buf.size(), m_speech_buf.size(), m_segment_time_offset});
+    m_batch_buf.insert(m_batch_buf.end(), m_speech_buf.cbegin(),
+                       m_speech_buf.cend());
 
-    auto decoding_start = std::chrono::steady_clock::now();
+    LOGD("speech frame batched: clips=" << m_batch_clips.size()
+                                        << ", samples=" << m_batch_buf.size());
+}
+
+void fasterwhisper_engine::decode_batch() {
+    decode_speech(m_batch_buf, m_batch_clips);
+
+    m_batch_buf.clear();
+    m_batch_clips.clear();
+}
+
+std::vector<std::pair<size_t, size_t>>
+fasterwhisper_engine::clip_timestamps(const std::vector<clip_t>& clips) {
+    // batched pipeline decodes only given clips, each of them must fit in
+    // one whisper window
+    std::vector<std::pair<size_t, size_t>> timestamps;
+
+    for (const auto& clip : clips) {
+        for (size_t pos = 0; pos < clip.size; pos += m_batch_chunk_size)
+            timestamps.emplace_back(
+                clip.start + pos,
+                clip.start + std::min(clip.size, pos + m_batch_chunk_size));
+    }
+
+    return timestamps;
+}
+
+std::optional<fasterwhisper_engine::transcript_t>
+fasterwhisper_engine::transcribe(const whisper_buf_t& buf,
+                                 const std::vector<clip_t>& clips,
+                                 bool batched) {
+    auto queued_time = std::chrono::steady_clock::now();
+
+    auto transcribe_task = [&]() {
+        record_stage(stage_t::queue, queued_time);
+        auto inference_start = std::chrono::steady_clock::now();
 
-    auto task = py_executor::instance()->execute([&]() {
         try {
-            py::array_t<float> array(buf.size());
-            auto r = array.mutable_unchecked<1>();
-            for (py::ssize_t i = 0; i < r.shape(0); ++i) r(i) = buf[i];
+            // numpy view of speech buf without copying, buf outlives the
+            // array because transcribe waits for this task, read-only so
+            // model can't modify speech buf in place
+            py::array_t<float> audio{static_cast<py::ssize_t>(buf.size()),
+                                     buf.data(), py::none()};
+            audio.attr("setflags")("write"_a = false);
+
+            py::dict batch_kwargs;
+            if (batched) {
+                py::list timestamps;
+                for (const auto& [start, end] : clip_timestamps(clips))
+                    timestamps.append(
+                        py::dict("start"_a = start, "end"_a = end));
+                batch_kwargs["clip_timestamps"] = std::move(timestamps);
+                batch_kwargs["batch_size"] = m_config.batch_size;
+            }
+
+            auto& transcriber = batched ? *m_batched_pipeline : *m_model;
 
-            auto seg_tuple = m_model->attr("transcribe")(
-                "audio"_a = array, "beam_size"_a = m_config.beam_search,
+            auto seg_tuple = transcriber.attr("transcribe")(
+                "audio"_a = audio, "beam_size"_a = m_config.beam_search,
                 "language"_a = m_auto_lang ? static_cast<py::object>(py::none())
                                            : static_cast<py::object>(
                                                  py::str(m_config.lang)),
@@ -347,78 +488,180 @@ void fasterwhisper_engine::decode_speech(const whisper_buf_t& buf) {
                 "initial_prompt"_a = m_config.initial_prompt.empty()
                                          ? static_cast<py::object>(py::none())
                                          : static_cast<py::object>(py::str(
-                                               m_config.initial_prompt)));
+                                               m_config.initial_prompt)),
+                **batch_kwargs);
+
+            transcript_t transcript;
+
+            if (m_auto_lang && seg_tuple.cast<py::list>().size() > 1)
+                transcript.lang = seg_tuple.cast<py::list>()[1]
+                                      .attr("language")
+                                      .cast<std::string>();
+
+            // segments are decoded lazily while iterating
+            for (auto& segment : *seg_tuple.cast<py::list>().begin()) {
+                transcript.segments.push_back(
+                    {0,
+                     static_cast<size_t>(
+                         std::max(0.0, segment.attr("start").cast<double>()) *
+                         1000),
+                     static_cast<size_t>(
+                         std::max(0.0, segment.attr("end").cast<double>()) *
+                         1000),
+                     segment.attr("text").cast<std::string>()});
+            }
 
-            auto segments = *seg_tuple.cast<py::list>().begin();
+            record_stage(stage_t::inference, inference_start);
 
-            std::string auto_lang = [&] {
-                if (!m_auto_lang) return m_config.lang;
-                if (seg_tuple.cast<py::list>().size() < 2) return m_config.lang;
-                auto lang = seg_tuple.cast<py::list>()[1]
-                                .attr("language")
-                                .cast<std::string>();
-                LOGD("auto lang: " << lang);
-                return lang;
-            }();
+            return std::optional<transcript_t>{std::move(transcript)};
+        } catch (const std::exception& err) {
+            LOGE("fasterwhisper py error: " << err.what());
+            return std::optional<transcript_t>{};
+        }
+    };
 
-            std::ostringstream os;
+    auto task = py_executor::instance()->execute(
+        std::move(transcribe_task), py_executor::priority_t::normal,
+        m_decode_cancel_token);
 
-            bool subrip = m_config.text_format == text_format_t::subrip;
+    if (!task) return std::nullopt;
 
-            auto i = 0;
-            for (auto& segment : segments) {
-                auto text = segment.attr("text").cast<std::string>();
+    auto task_result = task->get();
 
-                rtrim(text);
-                ltrim(text);
+    // empty when task was canceled
+    if (!task_result.has_value()) return std::nullopt;
 
-                if (text.empty()) continue;
-#ifdef DEBUG
-                LOGD("segment: " << text);
-#endif
+    return std::any_cast<std::optional<transcript_t>>(std::move(task_result));
+}
 
-                if (subrip) {
-                    auto t0 = static_cast<size_t>(std::max(
-                                  0.0, segment.attr("start").cast<double>())) *
-                              1000;
-                    auto t1 = static_cast<size_t>(std::max(
-                                  0.0, segment.attr("end").cast<double>())) *
-                              1000;
+std::optional<fasterwhisper_engine::transcript_t>
+fasterwhisper_engine::transcribe_in_worker(const whisper_buf_t& buf,
+                                           const std::vector<clip_t>& clips,
+                                           bool batched) {
+    auto inference_start = std::chrono::steady_clock::now();
+
+    py_worker::message_t request{
+        {"cmd", "transcribe"},
+        {"samples", buf.size()},
+        {"beam_size", m_config.beam_search},
+        {"task", m_config.translate && m_config.has_option('t')
+                     ? "translate"
+                     : "transcribe"}};
+    if (!m_auto_lang) request["language"] = m_config.lang;
+    if (!m_config.initial_prompt.empty())
+        request["initial_prompt"] = m_config.initial_prompt;
+    if (batched) {
+        auto& timestamps = request["clip_timestamps"];
+        for (const auto& [start, end] : clip_timestamps(clips))
+            timestamps.push_back({{"start", start}, {"end", end}});
+        request["batch_size"] = m_config.batch_size;
+    }
 
-                    t0 += m_segment_time_offset;
-                    t1 += m_segment_time_offset;
+    try {
+        auto reply = m_worker->call(request, buf.data(), buf.size());
 
-                    text_tools::segment_t segment{i + 1 + m_segment_offset, t0,
-                                                  t1, text};
-                    text_tools::break_segment_to_multiline(
-                        m_config.sub_config.min_line_length,
-                        m_config.sub_config.max_line_length, segment);
+        transcript_t transcript;
 
-                    text_tools::segment_to_subrip_text(segment, os);
-                } else {
-                    if (i != 0) os << ' ';
-                    os << std::move(text);
-                }
+        if (m_auto_lang) transcript.lang = reply.value("language", "");
+
+        for (const auto& segment : reply.at("segments")) {
+            transcript.segments.push_back(
+                {0,
+                 static_cast<size_t>(
+                     std::max(0.0, segment.at("start").get<double>()) * 1000),
+                 static_cast<size_t>(
+                     std::max(0.0, segment.at("end").get<double>()) * 1000),
+                 segment.at("text").get<std::string>()});
+        }
+
+        record_stage(stage_t::inference, inference_start);
+
+        return transcript;
+    } catch (const std::exception& err) {
+        LOGE("fasterwhisper worker error: " << err.what());
+    }
+
+    return std::nullopt;
+}
+
+void fasterwhisper_engine::decode_speech(const whisper_buf_t& buf,
+                                         const std::vector<clip_t>& clips) {
+    LOGD("speech decoding started: clips=" << clips.size());
+
+    create_model();
+
+    bool batched = use_batching();
+
+    auto decoding_start = std::chrono::steady_clock::now();
+
+    std::optional<transcript_t> transcript;
+
+    if (m_worker) {
+        transcript = transcribe_in_worker(buf, clips, batched);
+        if (!transcript && !m_thread_exit_requested) {
+            LOGW("py worker failed, falling back to in-process decoding");
+            m_worker.reset();
+            m_worker_batched = false;
+            m_worker_failed = true;
+            create_model();
+            batched = use_batching();
+        }
+    }
+
+    if (!m_worker && !transcript)
+        transcript = transcribe(buf, clips, batched);
+
+    if (!transcript || m_thread_exit_requested) return;
+
+    auto auto_lang = transcript->lang.empty() ? m_config.lang
+                                              : std::move(transcript->lang);
+    if (m_auto_lang) LOGD("auto lang: " << auto_lang);
+
+    bool subrip = m_config.text_format == text_format_t::subrip;
 
-                ++i;
+    std::ostringstream os;
+
+    auto i = 0;
+    for (auto& segment : transcript->segments) {
+        rtrim(segment.text);
+        ltrim(segment.text);
+
+        if (segment.text.empty()) continue;
+#ifdef DEBUG
+        LOGD("segment: " << segment.text);
+#endif
+
+        if (subrip) {
+            // map time in decoded buf to time in the whole audio
+            auto it = std::find_if(
+                clips.crbegin(), clips.crend(), [&](const auto& clip) {
+                    return (1000 * clip.start) / m_sample_rate <= segment.t0;
+                });
+            if (it != clips.crend()) {
+                auto clip_start = (1000 * it->start) / m_sample_rate;
+                segment.t0 += it->time_offset - clip_start;
+                segment.t1 = std::max(segment.t1, clip_start) +
+                             it->time_offset - clip_start;
             }
 
-            m_segment_offset += i;
+            segment.n = i + 1 + m_segment_offset;
 
-            return std::pair<std::string, std::string>(os.str(),
-                                                       std::move(auto_lang));
-        } catch (const std::exception& err) {
-            LOGE("fasterwhisper py error: " << err.what());
-            return std::pair<std::string, std::string>({}, {});
+            text_tools::break_segment_to_multiline(
+                m_config.sub_config.min_line_length,
+                m_config.sub_config.max_line_length, segment);
+
+            text_tools::segment_to_subrip_text(segment, os);
+        } else {
+            if (i != 0) os << ' ';
+            os << std::move(segment.text);
         }
-    });
 
-    if (!task) return;
+        ++i;
+    }
 
-    auto [text, auto_lang] =
-        std::any_cast<std::pair<std::string, std::string>>(task->get());
+    m_segment_offset += i;
 
-    if (m_thread_exit_requested) return;
+    auto text = os.str();
 
     auto stats = report_stats(
         buf.size(), m_sample_rate,
@@ -428,14 +671,19 @@ void fasterwhisper_engine::decode_speech(const whisper_buf_t& buf) {
                         std::chrono::steady_clock::now() - decoding_start)
                         .count()))));
 
+#ifdef DEBUG
+    LOGD("speech decoded: text=" << text);
+#endif
+
+    if (!m_config.insert_stats) {
+        merge_intermediate_text(std::move(text), auto_lang);
+        return;
+    }
+
     auto result = merge_texts(m_intermediate_text.value_or(std::string{}),
                               std::move(text));
 
-    if (m_config.insert_stats) result.append(" " + stats);
-
-#ifdef DEBUG
-    LOGD("speech decoded: text=" << result);
-#endif
+    result.append(" " + stats);
 
     if (!m_intermediate_text || m_intermediate_text != result)
         set_intermediate_text(result, auto_lang);
@@ -13,12 +13,17 @@
 #include <pybind11/pytypes.h>
 #define slots Q_SLOTS
 
+#include <memory>
 #include <optional>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "py_executor.hpp"
+#include "py_worker.hpp"
 #include "stt_engine.hpp"
+#include "text_tools.hpp"
 
 namespace py = pybind11;
 
@@ -32,14 +37,54 @@ class fasterwhisper_engine : public stt_engine {
 
     inline static const size_t m_speech_max_size = m_sample_rate * 60;  // 60s
     inline static const int m_threads = 8;
+    // length of audio window that batched pipeline decodes at once
+    inline static const size_t m_batch_chunk_size = m_sample_rate * 30;  // 30s
+
+    // part of the decoded buf that came from one speech frame
+    struct clip_t {
+        size_t start = 0;
+        size_t size = 0;
+        size_t time_offset = 0;
+    };
+
+    // decoded segment times are relative to decoded buf
+    struct transcript_t {
+        std::vector<text_tools::segment_t> segments;
+        std::string lang;
+    };
 
     std::optional<py::object> m_model;
+    std::optional<py::object> m_batched_pipeline;
+    // set when model is hosted in worker process instead of py_executor
+    std::shared_ptr<py_worker> m_worker;
+    bool m_worker_batched = false;
+    // worker call failed, model is created in-process from now on
+    bool m_worker_failed = false;
+    py_executor::cancel_token_t m_decode_cancel_token =
+        py_executor::make_cancel_token();
     whisper_buf_t m_speech_buf;
+    whisper_buf_t m_batch_buf;
+    std::vector<clip_t> m_batch_clips;
     bool m_auto_lang = false;
 
     void create_model();
+    bool create_model_in_worker();
+    int threads_to_use() const;
+    bool use_cuda_device() const;
     samples_process_result_t process_buff() override;
-    void decode_speech(const whisper_buf_t& buf);
+    void decode_speech(const whisper_buf_t& buf,
+                       const std::vector<clip_t>& clips);
+    std::optional<transcript_t> transcribe(const whisper_buf_t& buf,
+                                           const std::vector<clip_t>& clips,
+                                           bool batched);
+    std::optional<transcript_t> transcribe_in_worker(
+        const whisper_buf_t& buf, const std::vector<clip_t>& clips,
+        bool batched);
+    static std::vector<std::pair<size_t, size_t>> clip_timestamps(
+        const std::vector<clip_t>& clips);
+    bool use_batching() const;
+    void push_speech_to_batch();
+    void decode_batch();
     static void push_buf_to_whisper_buf(
         const std::vector<in_buf_t::buf_t::value_type>& buf,
         whisper_buf_t& whisper_buf);
@@ -14,6 +14,11 @@ file_source::file_source(const QString &file, int stream_index, QObject *parent)
     start();
 }
 
+file_source::~file_source() {
+    // decoder thread must not call data ready callback after this point
+    m_mc.cancel();
+}
+
 bool file_source::ok() const { return m_error; }
 
 void file_source::stop() {
@@ -61,11 +66,27 @@ void file_source::start() {
         1.0, stream,
         /*clip_info=*/{}};
 
+    // called from decoder thread
+    auto notify_data_ready = [this]() {
+        if (m_data_ready_pending.exchange(true)) return;
+        QMetaObject::invokeMethod(this, &file_source::handle_data_ready,
+                                  Qt::QueuedConnection);
+    };
+
     m_mc.decompress_to_data_raw_async({m_file.toStdString()},
                                       /*options=*/
                                       opts,
-                                      /*data_ready_callback=*/{},
-                                      /*task_finished_callback=*/{});
+                                      /*data_ready_callback=*/notify_data_ready,
+                                      /*task_finished_callback=*/
+                                      notify_data_ready);
+}
+
+void file_source::handle_data_ready() {
+    m_data_ready_pending = false;
+
+    if (m_stopped || m_ended) return;
+
+    handle_read_timeout();
 }
 
 void file_source::handle_read_timeout() {
@@ -12,6 +12,7 @@
 #include <QObject>
 #include <QString>
 #include <QTimer>
+#include <atomic>
 
 #include "audio_source.h"
 #include "media_compressor.hpp"
@@ -21,6 +22,7 @@ class file_source : public audio_source {
    public:
     explicit file_source(const QString &file, int stream_index,
                          QObject *parent = nullptr);
+    ~file_source() override;
     bool ok() const override;
     audio_data read_audio(char *buf, size_t max_size) override;
     double progress() const override;
@@ -45,9 +47,11 @@ class file_source : public audio_source {
     media_compressor m_mc;
     double m_progress = 0.0;
     int m_stream_index = -1;
+    std::atomic_bool m_data_ready_pending = false;
 
     void start();
     void handle_read_timeout();
+    void handle_data_ready();
 };
 
 #endif  // FILE_SOURCE_H
@@ -0,0 +1,87 @@
+/* Copyright (C) 2025 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Histogram of durations with power-of-two microsecond buckets. Counters
+// are relaxed atomics, so snapshot can be taken from any thread while
+// samples are being added.
+class latency_histogram {
+   public:
+    // bucket i holds durations < 2^i us, last bucket holds the rest
+    static const size_t bucket_count = 24;
+
+    struct snapshot_t {
+        uint64_t count = 0;
+        uint64_t total_us = 0;
+        uint64_t max_us = 0;
+        std::array<uint64_t, bucket_count> buckets{};
+
+        uint64_t mean_us() const { return count == 0 ? 0 : total_us / count; }
+
+        // upper bound of the bucket holding p-th percentile (p in 0-1)
+        uint64_t percentile_us(double p) const {
+            if (count == 0) return 0;
+
+            auto rank = static_cast<uint64_t>(p * static_cast<double>(count));
+            if (rank >= count) rank = count - 1;
+
+            uint64_t seen = 0;
+            for (size_t i = 0; i < bucket_count; ++i) {
+                seen += buckets[i];
+                if (seen > rank)
+                    return i + 1 == bucket_count ? max_us : uint64_t{1} << i;
+            }
+
+            return max_us;
+        }
+    };
+
+    void add(std::chrono::steady_clock::duration duration) {
+        auto us = static_cast<uint64_t>(std::max<int64_t>(
+            0, std::chrono::duration_cast<std::chrono::microseconds>(duration)
+                   .count()));
+
+        size_t idx = 0;
+        while (idx + 1 < bucket_count && (us >> idx) != 0) ++idx;
+
+        m_buckets[idx].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_total_us.fetch_add(us, std::memory_order_relaxed);
+
+        auto max = m_max_us.load(std::memory_order_relaxed);
+        while (us > max && !m_max_us.compare_exchange_weak(
+                               max, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    snapshot_t snapshot() const {
+        snapshot_t snapshot;
+        for (size_t i = 0; i < bucket_count; ++i)
+            snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        snapshot.count = m_count.load(std::memory_order_relaxed);
+        snapshot.total_us = m_total_us.load(std::memory_order_relaxed);
+        snapshot.max_us = m_max_us.load(std::memory_order_relaxed);
+        return snapshot;
+    }
+
+   private:
+    std::array<std::atomic<uint64_t>, bucket_count> m_buckets{};
+    std::atomic<uint64_t> m_count = 0;
+    std::atomic<uint64_t> m_total_us = 0;
+    std::atomic<uint64_t> m_max_us = 0;
+};
+
+#endif  // LATENCY_HISTOGRAM_HPP
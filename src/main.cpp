@@ -21,6 +21,7 @@
 #include <QUrl>
 #include <csignal>
 #include <cstdlib>
+#include <cstring>
 #include <memory>
 #include <utility>
 
@@ -49,19 +50,20 @@
 #include "dsnote_app.h"
 #include "logger.hpp"
 #include "models_list_model.h"
+#include "py_worker.hpp"
 #include "qtlogger.hpp"
 #include "settings.h"
 #include "speech_config.h"
 #include "speech_service.h"
 #include "text_tools.hpp"
 
-static void exit_program() {
+static void exit_program(int code = 0) {
     LOGD("exiting");
 
     speech_service::remove_cached_files();
 
     // workaround for python thread locking
-    std::quick_exit(0);
+    std::quick_exit(code);
 }
 
 static void signal_handler(int sig) {
@@ -101,7 +103,9 @@ static cmd::options check_options(const QCoreApplication& app) {
         QStringLiteral("print-state"),
         QStringLiteral(
             "Prints the current state in the application for the "
-            "specified <scope>. Supported scopes are: general, task."),
+            "specified <scope>. Supported scopes are: general, task, "
+            "stt-stats (only when speech service runs in a separate "
+            "process)."),
         QStringLiteral("scope")};
     parser.addOption(print_state_opt);
 
@@ -161,6 +165,17 @@ static cmd::options check_options(const QCoreApplication& app) {
         QStringLiteral("output-file")};
     parser.addOption(output_file_opt);
 
+    QCommandLineOption calibrate_opt{
+        QStringLiteral("calibrate-stt-model"),
+        QStringLiteral(
+            "Finds the fastest WhisperCpp settings for this CPU by decoding "
+            "<clip-file> (16 kHz mono wav with speech) and saves them for "
+            "the Performance profile. The model is the active one or the one "
+            "set with --id. Can't be used with --app. Exits with non-zero "
+            "code when calibration fails."),
+        QStringLiteral("clip-file")};
+    parser.addOption(calibrate_opt);
+
     QCommandLineOption gen_checksum_opt{
         QStringLiteral("gen-checksums"),
         QStringLiteral(
@@ -312,6 +327,19 @@ static cmd::options check_options(const QCoreApplication& app) {
         }
     }
 
+    options.calibration_file = parser.value(calibrate_opt);
+    if (!options.calibration_file.isEmpty()) {
+        if (options.launch_mode == settings::launch_mode_t::app) {
+            fmt::print(stderr, "Option --{} can't be used with --app.\n",
+                       calibrate_opt.names().front().toStdString());
+            options.valid = false;
+        } else if (options.model_id.isEmpty()) {
+            auto id = parser.value(id_opt);
+            if (!id.isEmpty() && text_tools::valid_model_id(id.toStdString()))
+                options.model_id = std::move(id);
+        }
+    }
+
     auto models_role_to_print = parser.value(print_models_opt);
     if (!models_role_to_print.isEmpty()) {
         if (models_role_to_print.contains("stt", Qt::CaseInsensitive)) {
@@ -352,6 +380,9 @@ static cmd::options check_options(const QCoreApplication& app) {
         if (state_scope_to_print.contains("task", Qt::CaseInsensitive)) {
             options.state_scope_to_print_flag |= cmd::scope_task;
         }
+        if (state_scope_to_print.contains("stt-stats", Qt::CaseInsensitive)) {
+            options.state_scope_to_print_flag |= cmd::scope_stt_stats;
+        }
         if (options.state_scope_to_print_flag == cmd::scope_none) {
             auto names = print_state_opt.names();
             fmt::print(stderr, "Invalid state scope in --{} option.\n",
@@ -432,6 +463,13 @@ static void start_service(const cmd::options& options) {
 
     if (options.gen_cheksums) models_manager::instance()->generate_checksums();
 
+    if (!options.calibration_file.isEmpty()) {
+        exit_program(speech_service::instance()->calibrate_stt_model(
+                         options.model_id, options.calibration_file)
+                         ? 0
+                         : 1);
+    }
+
     QGuiApplication::exec();
 }
 
@@ -445,6 +483,13 @@ static void start_app(const cmd::options& options,
 
         if (options.gen_cheksums)
             models_manager::instance()->generate_checksums();
+
+        if (!options.calibration_file.isEmpty()) {
+            exit_program(speech_service::instance()->calibrate_stt_model(
+                             options.model_id, options.calibration_file)
+                             ? 0
+                             : 1);
+        }
     }
 
 #ifdef USE_SFOS
@@ -517,6 +562,10 @@ static void start_app(const cmd::options& options,
 }
 
 int main(int argc, char* argv[]) {
+    // child process started by py_worker::spawn
+    if (argc == 4 && std::strcmp(argv[1], py_worker::cmd_arg) == 0)
+        return py_worker::run(argv[2], argv[3]);
+
 #ifdef USE_SFOS
     const auto& app = *SailfishApp::application(argc, argv);
 #else
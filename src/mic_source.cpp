@@ -119,6 +119,10 @@ void mic_source::init_audio(const QString& preferred_audio_input) {
 void mic_source::start() {
     m_audio_device = m_audio_input->start();
 
+    // audio is pushed as soon as a period is captured, timer only checks state
+    connect(m_audio_device, &QIODevice::readyRead, this,
+            &mic_source::handle_ready_read);
+
     m_timer.setInterval(200);  // 200 ms
     connect(&m_timer, &QTimer::timeout, this, &mic_source::handle_read_timeout);
     m_timer.start();
@@ -159,6 +163,13 @@ void mic_source::handle_read_timeout() {
     emit audio_available();
 }
 
+void mic_source::handle_ready_read() {
+    if (m_stopped || m_ended || m_audio_input->error() != QAudio::NoError)
+        return;
+
+    emit audio_available();
+}
+
 void mic_source::clear() {
     qDebug() << "mic clear";
 
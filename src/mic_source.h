@@ -44,6 +44,7 @@ class mic_source : public audio_source {
     void start();
     void handle_state_changed(QAudio::State new_state);
     void handle_read_timeout();
+    void handle_ready_read();
 };
 
 #endif  // MIC_SOURCE_H
@@ -467,6 +467,9 @@ void mnt_engine::process() {
 
         set_state(state_t::translating);
 
+        // bergamot uses one worker, core is reserved only while translating
+        auto lease = cpu_tools::acquire_threads(1);
+
         while (!is_shutdown() && !queue.empty()) {
             auto task = std::move(queue.front());
             queue.pop();
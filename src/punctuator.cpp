@@ -117,7 +117,9 @@ std::string punctuator::process(std::string text) {
                 }
 
                 return text;
-            });
+            },
+            // short task, it should not wait behind tts synthesis
+            py_executor::priority_t::high);
 
     if (task) return std::any_cast<std::string>(task->get());
 
@@ -9,7 +9,9 @@
 
 #include <fmt/format.h>
 
+#include <algorithm>
 #include <cstdlib>
+#include <iterator>
 #include <stdexcept>
 #include <string>
 
@@ -29,7 +31,11 @@ void py_executor::start() {
 void py_executor::stop() {
     LOGD("shutdown requested");
 
-    m_shutting_down = true;
+    {
+        std::lock_guard lock{m_mutex};
+        m_shutting_down = true;
+    }
+
     m_cv.notify_one();
 
     if (m_thread.joinable()) m_thread.join();
@@ -37,26 +43,94 @@ void py_executor::stop() {
     LOGD("shutdown completed");
 }
 
-std::optional<std::future<std::any> > py_executor::execute(task_t task) {
-    if (m_shutting_down || !m_thread.joinable()) {
-        LOGW(
-            "task not pushed because py executor loop not running or shutting "
-            "down");
-        return std::nullopt;
-    }
+std::optional<std::future<std::any> > py_executor::execute(
+    task_t task, priority_t priority, cancel_token_t cancel_token) {
+    std::future<std::any> future;
 
     {
         std::lock_guard lock{m_mutex};
 
-        m_task.emplace(std::move(task));
-        m_promise.emplace();
+        if (m_shutting_down || !m_thread.joinable()) {
+            LOGW(
+                "task not pushed because py executor loop not running or "
+                "shutting down");
+            return std::nullopt;
+        }
+
+        auto& queue = m_queues[static_cast<size_t>(priority)];
+        queue.push_back({std::move(task), {}, std::move(cancel_token)});
+        future = queue.back().promise.get_future();
     }
 
-    LOGD("task pushed");
+    LOGD("task pushed: priority=" << static_cast<int>(priority));
 
     m_cv.notify_one();
 
-    return m_promise->get_future();
+    return future;
+}
+
+void py_executor::cancel(const cancel_token_t& cancel_token) {
+    if (!cancel_token) return;
+
+    *cancel_token = true;
+
+    std::lock_guard lock{m_mutex};
+
+    for (auto& queue : m_queues) {
+        auto it = std::stable_partition(
+            queue.begin(), queue.end(), [&](const queued_task_t& queued_task) {
+                return queued_task.cancel_token != cancel_token;
+            });
+
+        if (it == queue.end()) continue;
+
+        LOGD("tasks canceled: " << std::distance(it, queue.end()));
+
+        for (auto cit = it; cit != queue.end(); ++cit)
+            cit->promise.set_value({});
+        queue.erase(it, queue.end());
+    }
+}
+
+std::optional<py_executor::queued_task_t> py_executor::pop_task() {
+    for (auto& queue : m_queues) {
+        if (queue.empty()) continue;
+
+        auto task = std::move(queue.front());
+        queue.pop_front();
+        return task;
+    }
+
+    return std::nullopt;
+}
+
+std::shared_ptr<py_worker> py_executor::acquire_worker() {
+    auto max_workers =
+        static_cast<size_t>(std::max(0, settings::instance()->py_workers()));
+    if (max_workers == 0) return {};
+
+    std::lock_guard lock{m_workers_mutex};
+
+    m_workers.erase(std::remove_if(m_workers.begin(), m_workers.end(),
+                                   [](const auto& worker) {
+                                       return worker.expired();
+                                   }),
+                    m_workers.end());
+
+    if (m_workers.size() >= max_workers) {
+        LOGD("all py workers are in use: " << m_workers.size());
+        return {};
+    }
+
+    try {
+        std::shared_ptr<py_worker> worker = py_worker::spawn();
+        m_workers.push_back(worker);
+        return worker;
+    } catch (const std::runtime_error& err) {
+        LOGE("failed to start py worker: " << err.what());
+    }
+
+    return {};
 }
 
 static std::string add_to_env_path(const std::string& dir) {
@@ -127,26 +201,36 @@ void py_executor::loop() {
         libs_availability = py_tools::libs_availability_t{};
 #endif
 
-        while (!m_shutting_down) {
-            std::unique_lock<std::mutex> lock{m_mutex};
-            m_cv.wait(lock,
-                      [this] { return m_shutting_down || m_task.has_value(); });
+        while (true) {
+            std::optional<queued_task_t> task;
 
-            auto task = std::move(m_task);
-            m_task.reset();
+            {
+                std::unique_lock<std::mutex> lock{m_mutex};
+                m_cv.wait(lock, [&] {
+                    if (m_shutting_down) return true;
+                    task = pop_task();
+                    return task.has_value();
+                });
 
-            if (m_shutting_down) {
-                if (task) m_promise->set_value({});
-                break;
+                if (m_shutting_down) {
+                    if (task) task->promise.set_value({});
+                    break;
+                }
+            }
+
+            if (task->cancel_token && *task->cancel_token) {
+                LOGD("py task canceled");
+                task->promise.set_value({});
+                continue;
             }
 
             try {
                 LOGD("py task execution: start");
-                m_promise->set_value(task.value()());
+                task->promise.set_value(task->task());
                 LOGD("py task execution: end");
             } catch (const std::exception& err) {
                 LOGE("py task error: " << err.what());
-                m_promise->set_exception(std::current_exception());
+                task->promise.set_exception(std::current_exception());
             }
         }
 
@@ -155,5 +239,17 @@ void py_executor::loop() {
         LOGE("error: " << err.what());
     }
 
+    {
+        // tasks left in queues will never run
+        std::lock_guard lock{m_mutex};
+
+        m_shutting_down = true;
+
+        for (auto& queue : m_queues) {
+            for (auto& queued_task : queue) queued_task.promise.set_value({});
+            queue.clear();
+        }
+    }
+
     LOGD("py executor loop ended");
 }
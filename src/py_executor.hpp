@@ -14,14 +14,20 @@
 #define slots Q_SLOTS
 
 #include <any>
+#include <array>
+#include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <future>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <thread>
+#include <vector>
 
 #include "py_tools.hpp"
+#include "py_worker.hpp"
 #include "singleton.h"
 
 namespace py = pybind11;
@@ -29,23 +35,49 @@ namespace py = pybind11;
 class py_executor : public singleton<py_executor> {
    public:
     using task_t = std::function<std::any()>;
+    enum class priority_t { high = 0, normal = 1, low = 2 };
+    // shared by tasks that can be canceled together, running task can
+    // check it to finish early
+    using cancel_token_t = std::shared_ptr<std::atomic_bool>;
+
     std::optional<py_tools::libs_availability_t> libs_availability;
     py_executor() = default;
     ~py_executor() override;
-    std::optional<std::future<std::any>> execute(task_t task);
+    std::optional<std::future<std::any>> execute(
+        task_t task, priority_t priority = priority_t::normal,
+        cancel_token_t cancel_token = {});
+    // queued tasks with this token are removed and get empty result
+    void cancel(const cancel_token_t& cancel_token);
+    // worker process for engine that hosts its model out of process, null
+    // when worker mode is disabled or all workers are in use
+    std::shared_ptr<py_worker> acquire_worker();
     void start();
     void stop();
+    static cancel_token_t make_cancel_token() {
+        return std::make_shared<std::atomic_bool>(false);
+    }
 
    private:
-    bool m_shutting_down = false;
+    struct queued_task_t {
+        task_t task;
+        std::promise<std::any> promise;
+        cancel_token_t cancel_token;
+    };
+
+    inline static const size_t m_priority_count = 3;
+
+    std::atomic_bool m_shutting_down = false;
     std::mutex m_mutex;
     std::condition_variable m_cv;
     std::thread m_thread;
     std::optional<py::scoped_interpreter> m_py_interpreter;
-    std::optional<task_t> m_task;
-    std::optional<std::promise<std::any>> m_promise;
+    // one fifo per priority
+    std::array<std::deque<queued_task_t>, m_priority_count> m_queues;
+    std::mutex m_workers_mutex;
+    std::vector<std::weak_ptr<py_worker>> m_workers;
 
     void loop();
+    std::optional<queued_task_t> pop_task();
 };
 
 #endif  // PYEXECUTOR_H
@@ -14,12 +14,25 @@
 #define slots Q_SLOTS
 #endif
 
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
 #include <QDebug>
+#include <QDir>
+#include <QFileInfo>
 #include <QStandardPaths>
 #include <QString>
+#include <algorithm>
+#include <fstream>
+#include <initializer_list>
+#include <optional>
+#include <sstream>
+#include <string>
 
 #include "cpu_tools.hpp"
 #include "logger.hpp"
+#include "nlohmann/json.hpp"
 #include "settings.h"
 
 #ifdef USE_PYTHON_MODULE
@@ -62,94 +75,206 @@ std::ostream& operator<<(std::ostream& os,
 }
 
 namespace py_tools {
-libs_availability_t libs_availability(libs_scan_type_t scan_type,
-                                      unsigned int scan_flags) {
-    // run only in py thread
+// bool fields of libs_availability_t stored in cache
+#define LIBS_AVAILABILITY_TABLE \
+    X(coqui_tts)                \
+    X(torch_cuda)               \
+    X(torch_hip)                \
+    X(faster_whisper)           \
+    X(ctranslate2_cuda)         \
+    X(mimic3_tts)               \
+    X(whisperspeech_tts)        \
+    X(parler_tts)               \
+    X(f5_tts)                   \
+    X(kokoro_tts)               \
+    X(transformers)             \
+    X(unikud)                   \
+    X(gruut_de)                 \
+    X(gruut_es)                 \
+    X(gruut_fa)                 \
+    X(gruut_fr)                 \
+    X(gruut_it)                 \
+    X(gruut_nl)                 \
+    X(gruut_ru)                 \
+    X(gruut_sw)                 \
+    X(kokoro_ja)                \
+    X(kokoro_zh)                \
+    X(mecab)                    \
+    X(uroman)
+
+static const auto libs_cache_file = "py_libs_availability.json";
+
+static std::string libs_cache_path() {
+    return settings::instance()->cache_dir().toStdString() + "/" +
+           libs_cache_file;
+}
 
-    libs_availability_t availability{};
+static std::optional<libs_availability_t> read_libs_cache(
+    const nlohmann::json& key) {
+    std::ifstream file{libs_cache_path()};
+    if (!file) return std::nullopt;
 
-    switch (scan_type) {
-        case libs_scan_type_t::on:
-            break;
-        case libs_scan_type_t::off_all_enabled:
-            if (cpu_tools::cpuinfo().feature_flags &
-                cpu_tools::feature_flags_t::avx) {
-                availability.coqui_tts = true;
-                availability.whisperspeech_tts = true;
-                availability.parler_tts = true;
-                availability.f5_tts = true;
-                availability.kokoro_tts = true;
-                availability.kokoro_ja = true;
-                availability.kokoro_zh = true;
-            }
-            availability.faster_whisper = true;
-            availability.mimic3_tts = true;
-            availability.transformers = true;
-            availability.unikud = true;
-            availability.gruut_de = true;
-            availability.gruut_es = true;
-            availability.gruut_fa = true;
-            availability.gruut_fr = true;
-            availability.gruut_it = true;
-            availability.gruut_nl = true;
-            availability.gruut_ru = true;
-            availability.gruut_sw = true;
-            availability.mecab = true;
-            availability.uroman = true;
-            break;
-        case libs_scan_type_t::off_all_disabled:
-            return availability;
+    auto json = nlohmann::json::parse(file, nullptr, false);
+    if (json.is_discarded() || !json.is_object()) {
+        LOGW("invalid py libs cache");
+        return std::nullopt;
     }
 
+    if (json.value("key", nlohmann::json{}) != key) {
+        LOGD("py libs cache is outdated");
+        return std::nullopt;
+    }
+
+    try {
+        const auto& libs = json.at("libs");
+        libs_availability_t availability{};
+#define X(name) availability.name = libs.at(#name).get<bool>();
+        LIBS_AVAILABILITY_TABLE
+#undef X
+        return availability;
+    } catch (const nlohmann::json::exception& err) {
+        LOGW("invalid py libs cache: " << err.what());
+    }
+
+    return std::nullopt;
+}
+
+static void write_libs_cache(const nlohmann::json& key,
+                             const libs_availability_t& availability) {
+    nlohmann::json libs;
+#define X(name) libs[#name] = availability.name;
+    LIBS_AVAILABILITY_TABLE
+#undef X
+
+    auto path = libs_cache_path();
+    QDir{}.mkpath(QFileInfo{QString::fromStdString(path)}.absolutePath());
+
+    std::ofstream file{path};
+    if (!file) {
+        LOGW("failed to write py libs cache: " << path);
+        return;
+    }
+
+    file << nlohmann::json{{"key", key}, {"libs", libs}};
+}
+
 #ifdef USE_PY
-    namespace py = pybind11;
-    using namespace pybind11::literals;
+namespace py = pybind11;
 
+// find_spec locates module without executing it (only parent package of
+// submodule is imported)
+static bool has_module(const char* name) {
+    LOGD("checking: " << name);
     try {
-        LOGD("checking: python version");
-        auto version_info = py::module_::import("sys").attr("version_info");
-        availability.py_version.major = version_info.attr("major").cast<int>();
-        availability.py_version.minor = version_info.attr("minor").cast<int>();
-        availability.py_version.micro = version_info.attr("micro").cast<int>();
-        LOGD("python version: " << availability.py_version);
+        return !py::module_::import("importlib.util")
+                    .attr("find_spec")(name)
+                    .is_none();
     } catch (const std::exception& err) {
-        LOGD("python version check py error: " << err.what());
+        LOGD(name << " check py error: " << err.what());
     }
+    return false;
+}
+
+// first line of file or empty string when file doesn't exist
+static std::string read_first_line(const char* path) {
+    std::ifstream file{path};
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// path with mtime and size of dir or only path when dir doesn't exist
+static nlohmann::json dir_cache_key(const std::string& dir) {
+    struct stat dir_stat {};
+    if (stat(dir.c_str(), &dir_stat) != 0 || !S_ISDIR(dir_stat.st_mode))
+        return {dir};
+    return {dir, dir_stat.st_mtim.tv_sec, dir_stat.st_mtim.tv_nsec,
+            dir_stat.st_size};
+}
+
+// scan result stays valid as long as interpreter, installed packages and
+// gpu drivers don't change, so key holds python version, mtime and size of
+// every dir in sys.path and of user site dir (it is added to sys.path only
+// when it exists, so pip install --user creating it must invalidate cache),
+// kernel release (in-tree drivers), nvidia and amd driver versions and
+// presence of their device nodes
+static nlohmann::json libs_cache_key(py_version_t py_version,
+                                     libs_scan_type_t scan_type,
+                                     unsigned int scan_flags) {
+    std::ostringstream version;
+    version << py_version;
+
+    auto paths = nlohmann::json::array();
+    try {
+        for (const auto& path : py::module_::import("sys").attr("path")) {
+            auto dir_key = dir_cache_key(path.cast<std::string>());
+            if (dir_key.size() > 1) paths.push_back(std::move(dir_key));
+        }
+    } catch (const std::exception& err) {
+        LOGD("sys path py error: " << err.what());
+    }
+
+    nlohmann::json user_site;
+    try {
+        user_site = dir_cache_key(py::module_::import("site")
+                                      .attr("getusersitepackages")()
+                                      .cast<std::string>());
+    } catch (const std::exception& err) {
+        LOGD("user site py error: " << err.what());
+    }
+
+    utsname uts{};
+
+    return {{"py_version", version.str()},
+            {"scan_type", static_cast<int>(scan_type)},
+            {"scan_flags", scan_flags},
+            {"avx", (cpu_tools::cpuinfo().feature_flags &
+                     cpu_tools::feature_flags_t::avx) != 0},
+            {"kernel", uname(&uts) == 0 ? uts.release : ""},
+            {"nvidia", access("/dev/nvidiactl", F_OK) == 0},
+            {"nvidia_driver", read_first_line("/proc/driver/nvidia/version")},
+            {"amd", access("/dev/kfd", F_OK) == 0},
+            {"amd_driver", read_first_line("/sys/module/amdgpu/version")},
+            {"paths", std::move(paths)},
+            {"user_site", std::move(user_site)}};
+}
+
+static void scan_gpu_libs(libs_availability_t& availability,
+                          unsigned int scan_flags) {
+    // torch and ctranslate2 have to be imported to query devices, but only
+    // when they are installed
 
     if ((scan_flags & settings::ScanFlagNoTorchCuda) > 0) {
         LOGD("checking: torch cuda (skipped)");
-    } else {
-        if (cpu_tools::cpuinfo().feature_flags &
-            cpu_tools::feature_flags_t::avx) {
-            try {
-                LOGD("checking: torch cuda");
-                auto torch_cuda = py::module_::import("torch.cuda");
-                auto torch_ver = py::module_::import("torch.version");
-                if (torch_cuda.attr("is_available")().cast<bool>()) {
-                    try {
-                        auto cuda_ver =
-                            torch_ver.attr("cuda").cast<std::string>();
-                        LOGD("torch cuda version: " << cuda_ver);
-                        availability.torch_cuda = !cuda_ver.empty();
-                    } catch ([[maybe_unused]] const py::cast_error& err) {
-                    }
-                    try {
-                        auto hip_ver =
-                            torch_ver.attr("hip").cast<std::string>();
-                        LOGD("torch hip version: " << hip_ver);
-                        availability.torch_hip = !hip_ver.empty();
-                    } catch ([[maybe_unused]] const py::cast_error& err) {
-                    }
+    } else if ((cpu_tools::cpuinfo().feature_flags &
+                cpu_tools::feature_flags_t::avx) &&
+               has_module("torch")) {
+        try {
+            LOGD("checking: torch cuda");
+            auto torch_cuda = py::module_::import("torch.cuda");
+            auto torch_ver = py::module_::import("torch.version");
+            if (torch_cuda.attr("is_available")().cast<bool>()) {
+                try {
+                    auto cuda_ver = torch_ver.attr("cuda").cast<std::string>();
+                    LOGD("torch cuda version: " << cuda_ver);
+                    availability.torch_cuda = !cuda_ver.empty();
+                } catch ([[maybe_unused]] const py::cast_error& err) {
+                }
+                try {
+                    auto hip_ver = torch_ver.attr("hip").cast<std::string>();
+                    LOGD("torch hip version: " << hip_ver);
+                    availability.torch_hip = !hip_ver.empty();
+                } catch ([[maybe_unused]] const py::cast_error& err) {
                 }
-            } catch (const std::exception& err) {
-                LOGD("torch cuda check py error: " << err.what());
             }
+        } catch (const std::exception& err) {
+            LOGD("torch cuda check py error: " << err.what());
         }
     }
 
     if ((scan_flags & settings::ScanFlagNoCt2Cuda) > 0) {
         LOGD("checking: ctranslate2-cuda (skipped)");
-    } else {
+    } else if (has_module("ctranslate2")) {
         try {
             LOGD("checking: ctranslate2-cuda");
             auto ct2 = py::module_::import("ctranslate2");
@@ -161,203 +286,132 @@ libs_availability_t libs_availability(libs_scan_type_t scan_type,
             LOGD("ctranslate2-cuda check py error: " << err.what());
         }
     }
+}
 
-    if (scan_type == libs_scan_type_t::off_all_enabled ||
-        scan_type == libs_scan_type_t::off_all_disabled) {
-        return availability;
-    }
+// true when all modules are found
+static bool has_modules(std::initializer_list<const char*> names) {
+    return std::all_of(names.begin(), names.end(), has_module);
+}
+
+static void scan_libs(libs_availability_t& availability) {
+    // heavy modules are imported later by engines that use them, so unlike
+    // import, find_spec doesn't check dependencies and the critical ones are
+    // checked explicitly
 
     if (cpu_tools::cpuinfo().feature_flags & cpu_tools::feature_flags_t::avx) {
-        try {
-            LOGD("checking: coqui tts");
-            py::module_::import("TTS");
-            availability.coqui_tts = true;
-        } catch (const std::exception& err) {
-            LOGD("coqui tts check py error: " << err.what());
+        bool torch = has_module("torch");
+        availability.coqui_tts = torch && has_module("TTS");
+        availability.whisperspeech_tts = torch && has_module("whisperspeech");
+        availability.parler_tts =
+            torch && has_modules({"parler_tts", "transformers"});
+        availability.f5_tts = torch && has_module("f5_tts");
+        availability.kokoro_tts = torch && has_modules({"kokoro", "misaki"});
+        if (availability.kokoro_tts) {
+            availability.kokoro_ja =
+                has_modules({"misaki.ja", "pyopenjtalk", "fugashi"});
+            availability.kokoro_zh =
+                has_modules({"misaki.zh", "jieba", "pypinyin"});
         }
+        availability.faster_whisper =
+            has_modules({"faster_whisper", "ctranslate2"});
+        availability.transformers =
+            torch && has_modules({"transformers", "accelerate"});
+        availability.unikud = torch && has_module("unikud");
+    } else {
+        LOGW("disabling torch dependent libraries as avx is not supported");
+    }
 
-        try {
-            LOGD("checking: whisperspeech tts");
-            py::module_::import("whisperspeech");
-            availability.whisperspeech_tts = true;
-        } catch (const std::exception& err) {
-            LOGD("whisperspeech tts check py error: " << err.what());
-        }
+    availability.mimic3_tts = has_modules({"mimic3_tts", "onnxruntime"});
+
+    if (has_module("gruut")) {
+        availability.gruut_de = has_module("gruut_lang_de");
+        availability.gruut_es = has_module("gruut_lang_es");
+        availability.gruut_fr = has_module("gruut_lang_fr");
+        availability.gruut_it = has_module("gruut_lang_it");
+        availability.gruut_ru = has_module("gruut_lang_ru");
+        availability.gruut_fa = has_module("gruut_lang_fa");
+        availability.gruut_sw = has_module("gruut_lang_sw");
+        availability.gruut_nl = has_module("gruut_lang_nl");
+    }
 
-        try {
-            LOGD("checking: parler tts");
-            py::module_::import("parler_tts");
-            LOGD("checking: transformers");
-            py::module_::import("transformers");
-            availability.parler_tts = true;
-        } catch (const std::exception& err) {
-            LOGD("parler tts check py error: " << err.what());
-        }
+    availability.mecab = has_module("MeCab") && has_module("unidic_lite");
+    availability.uroman = has_module("uroman");
+}
+#endif
 
-        try {
-            LOGD("checking: f5 tts");
-            py::module_::import("f5_tts");
-            availability.f5_tts = true;
-        } catch (const std::exception& err) {
-            LOGD("f5 tts check py error: " << err.what());
-        }
+libs_availability_t libs_availability(libs_scan_type_t scan_type,
+                                      unsigned int scan_flags) {
+    // run only in py thread
 
-        try {
-            LOGD("checking: kokoro tts");
-            py::module_::import("kokoro");
-            LOGD("checking: misaki");
-            py::module_::import("misaki");
-            availability.kokoro_tts = true;
-            try {
-                LOGD("checking: misaki.ja");
-                py::module_::import("misaki.ja");
+    libs_availability_t availability{};
+
+    switch (scan_type) {
+        case libs_scan_type_t::on:
+            break;
+        case libs_scan_type_t::off_all_enabled:
+            if (cpu_tools::cpuinfo().feature_flags &
+                cpu_tools::feature_flags_t::avx) {
+                availability.coqui_tts = true;
+                availability.whisperspeech_tts = true;
+                availability.parler_tts = true;
+                availability.f5_tts = true;
+                availability.kokoro_tts = true;
                 availability.kokoro_ja = true;
-            } catch (const std::exception& err) {
-                LOGD("kokoro kokoro.ja check py error: " << err.what());
-            }
-            try {
-                LOGD("checking: misaki.zh");
-                py::module_::import("misaki.zh");
                 availability.kokoro_zh = true;
-            } catch (const std::exception& err) {
-                LOGD("kokoro kokoro.zh check py error: " << err.what());
             }
-        } catch (const std::exception& err) {
-            LOGD("kokoro tts check py error: " << err.what());
-        }
-
-        try {
-            LOGD("checking: faster-whisper");
-            py::module_::import("faster_whisper");
             availability.faster_whisper = true;
-        } catch (const std::exception& err) {
-            LOGD("faster-whisper check py error: " << err.what());
-        }
-
-        try {
-            LOGD("checking: transformers");
-            py::module_::import("transformers");
-            LOGD("checking: accelerate");
-            py::module_::import("accelerate");
+            availability.mimic3_tts = true;
             availability.transformers = true;
-        } catch (const std::exception& err) {
-            LOGD("transformers check py error: " << err.what());
-        }
-
-        try {
-            LOGD("checking: unikud");
-            py::module_::import("unikud");
             availability.unikud = true;
-        } catch (const std::exception& err) {
-            LOGD("unikud check py error: " << err.what());
-        }
-    } else {
-        LOGW("disabling torch dependent libraries as avx is not supported");
-    }
-
-    try {
-        LOGD("checking: mimic3 tts");
-        py::module_::import("mimic3_tts");
-        availability.mimic3_tts = true;
-    } catch (const std::exception& err) {
-        LOGD("mimic3 tts check py error: " << err.what());
-    }
-
-    try {
-        LOGD("checking: gruut");
-        py::module_::import("gruut");
-
-        try {
-            LOGD("checking: gruut-de");
-            py::module_::import("gruut_lang_de");
             availability.gruut_de = true;
-        } catch (const std::exception& err) {
-            LOGD("py error: " << err.what());
-        }
-
-        try {
-            LOGD("checking: gruut-es");
-            py::module_::import("gruut_lang_es");
             availability.gruut_es = true;
-        } catch (const std::exception& err) {
-            LOGD("py error: " << err.what());
-        }
-
-        try {
-            LOGD("checking: gruut-fr");
-            py::module_::import("gruut_lang_fr");
+            availability.gruut_fa = true;
             availability.gruut_fr = true;
-        } catch (const std::exception& err) {
-            LOGD("py error: " << err.what());
-        }
-
-        try {
-            LOGD("checking: gruut-it");
-            py::module_::import("gruut_lang_it");
             availability.gruut_it = true;
-        } catch (const std::exception& err) {
-            LOGD("py error: " << err.what());
-        }
-
-        try {
-            LOGD("checking: gruut-ru");
-            py::module_::import("gruut_lang_ru");
+            availability.gruut_nl = true;
             availability.gruut_ru = true;
-        } catch (const std::exception& err) {
-            LOGD("py error: " << err.what());
-        }
-
-        try {
-            LOGD("checking: gruut-fa");
-            py::module_::import("gruut_lang_fa");
-            availability.gruut_fa = true;
-        } catch (const std::exception& err) {
-            LOGD("py error: " << err.what());
-        }
-
-        try {
-            LOGD("checking: gruut-sw");
-            py::module_::import("gruut_lang_sw");
             availability.gruut_sw = true;
-        } catch (const std::exception& err) {
-            LOGD("py error: " << err.what());
-        }
-
-        try {
-            LOGD("checking: gruut-nl");
-            py::module_::import("gruut_lang_nl");
-            availability.gruut_nl = true;
-        } catch (const std::exception& err) {
-            LOGD("py error: " << err.what());
-        }
-    } catch (const std::exception& err) {
-        LOGD("gruut check py error: " << err.what());
+            availability.mecab = true;
+            availability.uroman = true;
+            break;
+        case libs_scan_type_t::off_all_disabled:
+            return availability;
     }
 
+#ifdef USE_PY
     try {
-        LOGD("checking: mecab");
-        py::module_::import("MeCab");
-        LOGD("checking: unidic-lite");
-        py::module_::import("unidic_lite");
-        availability.mecab = true;
+        LOGD("checking: python version");
+        auto version_info = py::module_::import("sys").attr("version_info");
+        availability.py_version.major = version_info.attr("major").cast<int>();
+        availability.py_version.minor = version_info.attr("minor").cast<int>();
+        availability.py_version.micro = version_info.attr("micro").cast<int>();
+        LOGD("python version: " << availability.py_version);
     } catch (const std::exception& err) {
-        LOGD("mecab check py error: " << err.what());
+        LOGD("python version check py error: " << err.what());
     }
 
-    try {
-        LOGD("checking: uroman");
-        py::module_::import("uroman");
-        availability.uroman = true;
-    } catch (const std::exception& err) {
-        LOGD("uroman check py error: " << err.what());
+    auto cache_key =
+        libs_cache_key(availability.py_version, scan_type, scan_flags);
+
+    if (auto cached = read_libs_cache(cache_key)) {
+        cached->py_version = availability.py_version;
+        LOGD("py libs availability (cached): [" << *cached << "]");
+        return *cached;
     }
 
+    scan_gpu_libs(availability, scan_flags);
+
+    if (scan_type == libs_scan_type_t::on) scan_libs(availability);
+
     LOGD("py libs availability: [" << availability << "]");
 
+    write_libs_cache(cache_key, availability);
+
     try {
         // release mem
         py::module_::import("gc").attr("collect")();
-        py::module_::import("torch").attr("cuda").attr("empty_cache")();
+        if (py::module_::import("sys").attr("modules").contains("torch"))
+            py::module_::import("torch").attr("cuda").attr("empty_cache")();
     } catch (const std::exception& err) {
         LOGE("py error: " << err.what());
     }
@@ -0,0 +1,462 @@
+/* Copyright (C) 2025 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "py_worker.hpp"
+
+#undef slots
+#include <pybind11/embed.h>
+#include <pybind11/numpy.h>
+#include <pybind11/pytypes.h>
+#define slots Q_SLOTS
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "logger.hpp"
+
+extern char** environ;
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+
+static void write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        auto ret = send(fd, data, size, MSG_NOSIGNAL);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error{std::string{"py worker send error: "} +
+                                     std::strerror(errno)};
+        }
+        data += ret;
+        size -= ret;
+    }
+}
+
+// returns false on eof before first byte
+static bool read_all(int fd, char* data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        auto ret = read(fd, data + done, size - done);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error{std::string{"py worker read error: "} +
+                                     std::strerror(errno)};
+        }
+        if (ret == 0) {
+            if (done == 0) return false;
+            throw std::runtime_error{"py worker unexpected eof"};
+        }
+        done += ret;
+    }
+    return true;
+}
+
+void py_worker::send_message(int fd, const std::string& payload,
+                             int attached_fd) {
+    auto size = static_cast<uint32_t>(payload.size());
+
+    iovec iov{&size, sizeof(size)};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    char cmsg_buf[CMSG_SPACE(sizeof(int))]{};
+    if (attached_fd >= 0) {
+        msg.msg_control = cmsg_buf;
+        msg.msg_controllen = sizeof(cmsg_buf);
+        auto* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &attached_fd, sizeof(int));
+    }
+
+    ssize_t ret;
+    do {
+        ret = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret <= 0)
+        throw std::runtime_error{std::string{"py worker send error: "} +
+                                 std::strerror(errno)};
+
+    write_all(fd, reinterpret_cast<const char*>(&size) + ret,
+              sizeof(size) - ret);
+    write_all(fd, payload.data(), payload.size());
+}
+
+bool py_worker::recv_message(int fd, std::string& payload, int& attached_fd) {
+    attached_fd = -1;
+
+    uint32_t size = 0;
+    iovec iov{&size, sizeof(size)};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    char cmsg_buf[CMSG_SPACE(sizeof(int))]{};
+    msg.msg_control = cmsg_buf;
+    msg.msg_controllen = sizeof(cmsg_buf);
+
+    ssize_t ret;
+    do {
+        ret = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0)
+        throw std::runtime_error{std::string{"py worker read error: "} +
+                                 std::strerror(errno)};
+    if (ret == 0) return false;
+
+    for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            std::memcpy(&attached_fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+
+    if (static_cast<size_t>(ret) < sizeof(size) &&
+        !read_all(fd, reinterpret_cast<char*>(&size) + ret,
+                  sizeof(size) - ret))
+        throw std::runtime_error{"py worker unexpected eof"};
+
+    payload.resize(size);
+    if (size > 0 && !read_all(fd, payload.data(), size))
+        throw std::runtime_error{"py worker unexpected eof"};
+
+    return true;
+}
+
+py_worker::py_worker(int fd, pid_t pid) : m_fd{fd}, m_pid{pid} {}
+
+py_worker::~py_worker() {
+    LOGD("py worker dtor: pid=" << m_pid);
+
+    if (m_shm) munmap(m_shm, m_shm_size);
+    if (m_shm_fd >= 0) close(m_shm_fd);
+
+    // worker exits when socket is closed
+    if (m_fd >= 0) close(m_fd);
+
+    for (int i = 0; i < 100; ++i) {
+        if (waitpid(m_pid, nullptr, WNOHANG) != 0) return;
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+
+    LOGW("py worker didn't exit, killing: pid=" << m_pid);
+
+    kill(m_pid, SIGKILL);
+    waitpid(m_pid, nullptr, 0);
+}
+
+std::unique_ptr<py_worker> py_worker::spawn() {
+    // both ends are close-on-exec, so workers spawned at the same time from
+    // other threads don't inherit them
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+        throw std::runtime_error{std::string{"py worker socketpair error: "} +
+                                 std::strerror(errno)};
+
+    // only worker's end is passed to worker, dup2 clears close-on-exec
+    int child_fd = fds[1] == m_child_fd ? m_child_fd + 1 : m_child_fd;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    auto ret = posix_spawn_file_actions_adddup2(&actions, fds[1], child_fd);
+
+    auto fd_arg = std::to_string(child_fd);
+    auto log_level_arg = std::to_string(static_cast<int>(Logger::level()));
+    char* argv[] = {const_cast<char*>("dsnote"), const_cast<char*>(cmd_arg),
+                    fd_arg.data(), log_level_arg.data(), nullptr};
+
+    pid_t pid = -1;
+    if (ret == 0)
+        ret = posix_spawn(&pid, "/proc/self/exe", &actions, nullptr, argv,
+                          environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+
+    if (ret != 0) {
+        close(fds[0]);
+        throw std::runtime_error{std::string{"py worker spawn error: "} +
+                                 std::strerror(ret)};
+    }
+
+    LOGD("py worker spawned: pid=" << pid);
+
+    return std::unique_ptr<py_worker>{new py_worker{fds[0], pid}};
+}
+
+void py_worker::copy_to_shm(const float* samples, size_t count) {
+    auto size = count * sizeof(float);
+
+    if (m_shm_fd < 0) {
+        m_shm_fd = memfd_create("dsnote-py-worker", MFD_CLOEXEC);
+        if (m_shm_fd < 0)
+            throw std::runtime_error{std::string{"memfd_create error: "} +
+                                     std::strerror(errno)};
+    }
+
+    if (size > m_shm_size) {
+        if (m_shm) munmap(m_shm, m_shm_size);
+        m_shm = nullptr;
+        m_shm_size = 0;
+
+        if (ftruncate(m_shm_fd, size) != 0)
+            throw std::runtime_error{std::string{"ftruncate error: "} +
+                                     std::strerror(errno)};
+
+        m_shm = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     m_shm_fd, 0);
+        if (m_shm == MAP_FAILED) {
+            m_shm = nullptr;
+            throw std::runtime_error{std::string{"mmap error: "} +
+                                     std::strerror(errno)};
+        }
+        m_shm_size = size;
+    }
+
+    std::memcpy(m_shm, samples, size);
+}
+
+py_worker::message_t py_worker::call(const message_t& request,
+                                     const float* samples, size_t count) {
+    std::lock_guard lock{m_mutex};
+
+    if (samples != nullptr) copy_to_shm(samples, count);
+
+    send_message(
+        m_fd,
+        request.dump(-1, ' ', false, message_t::error_handler_t::replace),
+        samples != nullptr ? m_shm_fd : -1);
+
+    std::string payload;
+    int attached_fd = -1;
+    if (!recv_message(m_fd, payload, attached_fd))
+        throw std::runtime_error{"py worker exited"};
+    if (attached_fd >= 0) close(attached_fd);
+
+    auto reply = message_t::parse(payload);
+
+    if (!reply.value("ok", false))
+        throw std::runtime_error{"py worker error: " +
+                                 reply.value("error", std::string{})};
+
+    return reply;
+}
+
+namespace {
+struct worker_state_t {
+    std::optional<py::object> model;
+    std::optional<py::object> batched_pipeline;
+};
+
+struct shm_mapping_t {
+    void* addr = nullptr;
+    size_t size = 0;
+};
+}  // namespace
+
+static py::object str_or_none(const py_worker::message_t& request,
+                              const char* key) {
+    auto it = request.find(key);
+    if (it != request.end() && it->is_string())
+        return py::str(it->get<std::string>());
+    return py::none();
+}
+
+static py_worker::message_t load_fasterwhisper(
+    const py_worker::message_t& request, worker_state_t& state) {
+    auto fw = py::module_::import("faster_whisper");
+
+    auto make_model = [&](bool flash_attn) {
+        py::dict kwargs(
+            "model_size_or_path"_a = request.at("model").get<std::string>(),
+            "device"_a = request.value("device", std::string{"cpu"}),
+            "device_index"_a = request.value("device_index", 0),
+            "local_files_only"_a = true,
+            "cpu_threads"_a = request.value("cpu_threads", 4));
+        if (flash_attn) kwargs["flash_attention"] = true;
+        state.model.emplace(fw.attr("WhisperModel")(**kwargs));
+    };
+
+    if (request.value("flash_attention", false)) {
+        try {
+            make_model(true);
+        } catch (const std::exception& err) {
+            LOGW("retrying with disabled flash-attention: " << err.what());
+            make_model(false);
+        }
+    } else {
+        make_model(false);
+    }
+
+    bool batched = request.value("batch_size", 0) > 1 &&
+                   py::hasattr(fw, "BatchedInferencePipeline");
+    if (batched)
+        state.batched_pipeline.emplace(
+            fw.attr("BatchedInferencePipeline")("model"_a = *state.model));
+
+    return {{"batched", batched}};
+}
+
+static py_worker::message_t transcribe_fasterwhisper(
+    const py_worker::message_t& request, int shm_fd, worker_state_t& state) {
+    if (!state.model) throw std::runtime_error{"model not loaded"};
+    if (shm_fd < 0) throw std::runtime_error{"no samples"};
+
+    auto count = request.at("samples").get<size_t>();
+
+    // private mapping, so python can't modify samples of the main process
+    auto* mapping = new shm_mapping_t{
+        mmap(nullptr, count * sizeof(float), PROT_READ | PROT_WRITE,
+             MAP_PRIVATE, shm_fd, 0),
+        count * sizeof(float)};
+    if (mapping->addr == MAP_FAILED) {
+        delete mapping;
+        throw std::runtime_error{std::string{"mmap error: "} +
+                                 std::strerror(errno)};
+    }
+
+    // mapping lives as long as the array
+    py::capsule owner{mapping, [](void* ptr) {
+                          auto* mapping = static_cast<shm_mapping_t*>(ptr);
+                          munmap(mapping->addr, mapping->size);
+                          delete mapping;
+                      }};
+    py::array_t<float> audio{static_cast<py::ssize_t>(count),
+                             static_cast<float*>(mapping->addr), owner};
+
+    py::dict kwargs(
+        "audio"_a = audio, "beam_size"_a = request.value("beam_size", 5),
+        "language"_a = str_or_none(request, "language"),
+        "task"_a = request.value("task", std::string{"transcribe"}),
+        "initial_prompt"_a = str_or_none(request, "initial_prompt"));
+
+    bool batched =
+        state.batched_pipeline && request.contains("clip_timestamps");
+    if (batched) {
+        py::list clip_timestamps;
+        for (const auto& clip : request.at("clip_timestamps"))
+            clip_timestamps.append(
+                py::dict("start"_a = clip.at("start").get<size_t>(),
+                         "end"_a = clip.at("end").get<size_t>()));
+        kwargs["clip_timestamps"] = std::move(clip_timestamps);
+        kwargs["batch_size"] = request.value("batch_size", 8);
+    }
+
+    auto& transcriber = batched ? *state.batched_pipeline : *state.model;
+    auto seg_tuple = transcriber.attr("transcribe")(**kwargs).cast<py::list>();
+
+    py_worker::message_t segments = py_worker::message_t::array();
+    for (auto& segment : seg_tuple[0]) {
+        segments.push_back(
+            {{"text", segment.attr("text").cast<std::string>()},
+             {"start", segment.attr("start").cast<double>()},
+             {"end", segment.attr("end").cast<double>()}});
+    }
+
+    auto lang = seg_tuple.size() < 2
+                    ? std::string{}
+                    : seg_tuple[1].attr("language").cast<std::string>();
+
+    return {{"segments", std::move(segments)}, {"language", std::move(lang)}};
+}
+
+static py_worker::message_t handle_request(const py_worker::message_t& request,
+                                           int shm_fd, worker_state_t& state) {
+    auto cmd = request.at("cmd").get<std::string>();
+
+    LOGD("py worker request: " << cmd);
+
+    if (cmd == "load") {
+        auto engine = request.at("engine").get<std::string>();
+        if (engine == "fasterwhisper")
+            return load_fasterwhisper(request, state);
+        throw std::runtime_error{"unsupported engine: " + engine};
+    }
+
+    if (cmd == "transcribe")
+        return transcribe_fasterwhisper(request, shm_fd, state);
+
+    throw std::runtime_error{"unknown command: " + cmd};
+}
+
+// Worker exits on socket eof when main process is gone, but it doesn't
+// read socket while transcribing, so parent is also checked periodically.
+// PR_SET_PDEATHSIG can't be used as it fires when spawning thread exits.
+static void watch_parent(pid_t parent_pid) {
+    std::thread{[parent_pid] {
+        while (getppid() == parent_pid)
+            std::this_thread::sleep_for(std::chrono::seconds{1});
+        LOGW("main process is gone, py worker exits");
+        _exit(1);
+    }}.detach();
+}
+
+int py_worker::run(const char* fd_arg, const char* log_level_arg) {
+    Logger::init(static_cast<Logger::LogType>(std::atoi(log_level_arg)));
+
+    watch_parent(getppid());
+
+    int fd = std::atoi(fd_arg);
+    // not inherited by processes started by python code
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    LOGD("py worker started: pid=" << getpid());
+
+    try {
+        py::scoped_interpreter interpreter;
+        worker_state_t state;
+
+        std::string payload;
+        int shm_fd = -1;
+        while (recv_message(fd, payload, shm_fd)) {
+            message_t reply;
+
+            try {
+                reply =
+                    handle_request(message_t::parse(payload), shm_fd, state);
+                reply["ok"] = true;
+            } catch (const std::exception& err) {
+                LOGE("py worker error: " << err.what());
+                reply = {{"ok", false}, {"error", err.what()}};
+            }
+
+            if (shm_fd >= 0) close(shm_fd);
+
+            send_message(fd,
+                         reply.dump(-1, ' ', false,
+                                    message_t::error_handler_t::replace),
+                         -1);
+        }
+
+        state.batched_pipeline.reset();
+        state.model.reset();
+    } catch (const std::exception& err) {
+        LOGE("py worker error: " << err.what());
+        return 1;
+    }
+
+    LOGD("py worker ended: pid=" << getpid());
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+/* Copyright (C) 2025 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef PY_WORKER_HPP
+#define PY_WORKER_HPP
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "nlohmann/json.hpp"
+
+// Child process with its own python interpreter that hosts one model, so
+// it doesn't compete for GIL with engines running in py_executor.
+// Requests and replies are json messages sent over unix socket. Audio
+// samples are passed in shared memory.
+class py_worker {
+   public:
+    using message_t = nlohmann::json;
+    // first argument of the app binary started as worker
+    inline static const char* const cmd_arg = "--py-worker";
+
+    py_worker(const py_worker&) = delete;
+    py_worker& operator=(const py_worker&) = delete;
+    ~py_worker();
+    // starts worker process, throws on error
+    static std::unique_ptr<py_worker> spawn();
+    // entry point of worker process
+    static int run(const char* fd_arg, const char* log_level_arg);
+    // sends request and waits for reply, throws on error
+    message_t call(const message_t& request, const float* samples = nullptr,
+                   size_t count = 0);
+    inline auto pid() const { return m_pid; }
+    // message is 4-byte size followed by payload, optional fd is attached
+    // to the size bytes
+    static void send_message(int fd, const std::string& payload,
+                             int attached_fd = -1);
+    // returns false when other side closed socket
+    static bool recv_message(int fd, std::string& payload, int& attached_fd);
+
+   private:
+    // socket fd number in worker process
+    inline static const int m_child_fd = 3;
+
+    int m_fd = -1;
+    pid_t m_pid = -1;
+    std::mutex m_mutex;
+    // shared memory for samples, reused between calls
+    int m_shm_fd = -1;
+    void* m_shm = nullptr;
+    size_t m_shm_size = 0;
+
+    py_worker(int fd, pid_t pid);
+    void copy_to_shm(const float* samples, size_t count);
+};
+
+#endif  // PY_WORKER_HPP
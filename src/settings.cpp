@@ -1093,6 +1093,19 @@ void settings::set_module_checksum(const QString& name, const QString& value) {
     }
 }
 
+QString settings::whispercpp_tuning(const QString& key) const {
+    return value(QStringLiteral("service/whispercpp_tuning_%1").arg(key))
+        .toString();
+}
+
+void settings::set_whispercpp_tuning(const QString& key, const QString& value) {
+    if (value != whispercpp_tuning(key)) {
+        setValue(QStringLiteral("service/whispercpp_tuning_%1").arg(key),
+                 value);
+        sync();
+    }
+}
+
 QString settings::prev_app_ver() const {
     return value(QStringLiteral("prev_app_ver")).toString();
 }
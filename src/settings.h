@@ -46,6 +46,13 @@
     X(hotkeys_enabled, bool, false)                   \
     X(mtag, bool, false)                              \
     X(use_toggle_for_hotkey, bool, true)              \
+    X(models_cache_max_mem, int, 0) /* MB */          \
+    X(stt_vad_mode, int, 3) /* 4 is silero */         \
+    X(stt_silero_vad_model_file, QString, QString{})  \
+    X(whispercpp_streaming, bool, false)              \
+    X(fasterwhisper_batch_size, int, 8) /* files */   \
+    X(pin_engine_threads, bool, false)                \
+    X(py_workers, int, 0) /* 0 is in-process */       \
     X(window_size_ratio, double, 0.6)
 
 // name, default value
@@ -682,6 +689,8 @@ class settings : public QSettings, public singleton<settings> {
     static launch_mode_t launch_mode;
     QString module_checksum(const QString &name) const;
     void set_module_checksum(const QString &name, const QString &value);
+    QString whispercpp_tuning(const QString &key) const;
+    void set_whispercpp_tuning(const QString &key, const QString &value);
     void scan_hw_devices(unsigned int hw_feature_flags);
     void update_hw_devices_from_fa(const QVariantMap &features_availability);
     void disable_hw_scan();
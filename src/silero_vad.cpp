@@ -0,0 +1,85 @@
+/* Copyright (C) 2025 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "silero_vad.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "audio_tools.hpp"
+#include "logger.hpp"
+
+silero_vad::silero_vad(const std::string& model_file, float threshold)
+    : m_threshold{threshold} {
+    if (model_file.empty())
+        throw std::runtime_error("silero vad model file is empty");
+
+    try {
+        Ort::SessionOptions options;
+        // chunks are tiny, more threads only add sync overhead
+        options.SetIntraOpNumThreads(1);
+        options.SetInterOpNumThreads(1);
+        options.SetGraphOptimizationLevel(
+            GraphOptimizationLevel::ORT_ENABLE_ALL);
+
+        m_session.emplace(m_env, model_file.c_str(), options);
+    } catch (const Ort::Exception& err) {
+        throw std::runtime_error(err.what());
+    }
+
+    LOGD("silero vad created: " << model_file);
+
+    restart();
+}
+
+void silero_vad::restart() {
+    m_input.fill(0.0F);
+    m_state.fill(0.0F);
+}
+
+bool silero_vad::is_speech_chunk(const vad::buf_t::value_type* chunk) {
+    // model input is context of previous chunk followed by current chunk
+    audio_tools::s16_to_f32(chunk, m_chunk_size,
+                            m_input.data() + m_context_size);
+
+    const std::array<int64_t, 2> input_shape{
+        1, static_cast<int64_t>(m_input.size())};
+    const std::array<int64_t, 3> state_shape{2, 1, 128};
+
+    std::vector<Ort::Value> inputs;
+    inputs.reserve(3);
+    inputs.push_back(Ort::Value::CreateTensor<float>(
+        m_mem_info, m_input.data(), m_input.size(), input_shape.data(),
+        input_shape.size()));
+    inputs.push_back(Ort::Value::CreateTensor<float>(
+        m_mem_info, m_state.data(), m_state.size(), state_shape.data(),
+        state_shape.size()));
+    inputs.push_back(Ort::Value::CreateTensor<int64_t>(
+        m_mem_info, &m_sample_rate, 1, nullptr, 0));
+
+    static const std::array<const char*, 3> input_names{"input", "state",
+                                                        "sr"};
+    static const std::array<const char*, 2> output_names{"output", "stateN"};
+
+    try {
+        auto outputs = m_session->Run(
+            Ort::RunOptions{nullptr}, input_names.data(), inputs.data(),
+            inputs.size(), output_names.data(), output_names.size());
+
+        auto prob = outputs[0].GetTensorData<float>()[0];
+
+        std::copy_n(outputs[1].GetTensorData<float>(), m_state.size(),
+                    m_state.begin());
+        std::copy_n(m_input.end() - m_context_size, m_context_size,
+                    m_input.begin());
+
+        return prob >= m_threshold;
+    } catch (const Ort::Exception& err) {
+        throw std::runtime_error(err.what());
+    }
+}
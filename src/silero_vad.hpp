@@ -0,0 +1,43 @@
+/* Copyright (C) 2025 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SILERO_VAD_H
+#define SILERO_VAD_H
+
+#include <onnxruntime_cxx_api.h>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "vad.hpp"
+
+// silero vad v5 onnx model running on cpu
+class silero_vad : public vad::backend {
+   public:
+    silero_vad(const std::string& model_file, float threshold);
+    size_t chunk_size() const override { return m_chunk_size; }
+    void restart() override;
+    bool is_speech_chunk(const vad::buf_t::value_type* chunk) override;
+
+   private:
+    inline static const size_t m_chunk_size = 512;  // 32 ms
+    inline static const size_t m_context_size = 64;
+    inline static const size_t m_state_size = 2 * 1 * 128;
+
+    float m_threshold = 0.5F;
+    Ort::Env m_env{ORT_LOGGING_LEVEL_WARNING, "silero-vad"};
+    Ort::MemoryInfo m_mem_info =
+        Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    std::optional<Ort::Session> m_session;
+    std::array<float, m_context_size + m_chunk_size> m_input{};
+    std::array<float, m_state_size> m_state{};
+    int64_t m_sample_rate = 16000;
+};
+
+#endif  // SILERO_VAD_H
@@ -12,16 +12,21 @@
 #include <QCoreApplication>
 #include <QDBusConnection>
 #include <QDebug>
+#include <QDirIterator>
 #include <QEventLoop>
+#include <QFileInfo>
 #include <algorithm>
 #include <cstdlib>
 #include <functional>
 #include <numeric>
 #include <optional>
+#include <sstream>
 #include <set>
 
 #include "april_engine.hpp"
+#include "audio_tools.hpp"
 #include "coqui_engine.hpp"
+#include "cpu_tools.hpp"
 #include "ds_engine.hpp"
 #include "espeak_engine.hpp"
 #include "f5_engine.hpp"
@@ -190,6 +195,13 @@ speech_service::speech_service(QObject *parent)
     : QObject{parent}, m_dbus_service_adaptor{this} {
     qDebug() << "starting service:" << settings::launch_mode;
 
+    cpu_tools::set_thread_pinning(settings::instance()->pin_engine_threads());
+    connect(settings::instance(), &settings::pin_engine_threads_changed, this,
+            [] {
+                cpu_tools::set_thread_pinning(
+                    settings::instance()->pin_engine_threads());
+            });
+
     connect(models_manager::instance(), &models_manager::models_changed, this,
             &speech_service::handle_models_changed);
     connect(models_manager::instance(), &models_manager::busy_changed, this,
@@ -1255,10 +1267,196 @@ static std::vector<int> whispercpp_vulkan_devices() {
     return devs;
 }
 
+static size_t model_files_size(std::initializer_list<std::string> paths) {
+    size_t size = 0;
+
+    for (const auto &path : paths) {
+        if (path.empty()) continue;
+
+        QFileInfo info{QString::fromStdString(path)};
+        if (info.isDir()) {
+            QDirIterator it{info.filePath(), QDir::Files,
+                            QDirIterator::Subdirectories};
+            while (it.hasNext()) {
+                it.next();
+                size += it.fileInfo().size();
+            }
+        } else {
+            size += info.size();
+        }
+    }
+
+    return size;
+}
+
+template <typename T>
+void speech_service::park_engine(std::unique_ptr<T> &engine,
+                                 cached_engine_t &cached) {
+    if (!engine) return;
+
+    m_engines_cache.set_max_size(
+        static_cast<size_t>(
+            std::max(0, settings::instance()->models_cache_max_mem())) *
+        1024 * 1024);
+
+    // only base stop, it ends processing but keeps model loaded (engine
+    // specific stop that unloads model runs from destructor)
+    engine->T::stop();
+
+    if (cached.cacheable &&
+        m_engines_cache.put(cached.key, std::move(engine), cached.size,
+                            cached.model_key)) {
+        qDebug() << "engine moved to cache:" << cached.key;
+    } else {
+        engine.reset();
+        qDebug() << "engine destroyed successfully";
+    }
+
+    cached = {};
+
+    qDebug() << "engines cache:" << m_engines_cache.stats();
+}
+
+// calibration is valid only for the same model and cpu
+static QString whispercpp_tuning_key(const QString &model_id) {
+    auto cpuinfo = cpu_tools::cpuinfo();
+    return QStringLiteral("%1_%2_%3_%4")
+        .arg(model_id, QString::number(static_cast<int>(cpu_tools::arch())),
+             QString::number(cpuinfo.number_of_processors),
+             QString::number(cpuinfo.feature_flags));
+}
+
+// cpu lib variant is applied always, decoding params only when requested
+static void apply_whispercpp_tuning(const QString &model_id,
+                                    stt_engine::config_t &config,
+                                    bool apply_params) {
+    auto values = settings::instance()
+                      ->whispercpp_tuning(whispercpp_tuning_key(model_id))
+                      .split(',');
+    if (values.size() != 3 && values.size() != 4) return;
+
+    if (values.size() == 4)
+        config.cpu_lib_variant = values.at(3).toStdString();
+
+    if (!apply_params) return;
+
+    bool ok_threads = false, ok_ctx = false, ok_beam = false;
+    auto threads = values.at(0).toUInt(&ok_threads);
+    auto ctx = values.at(1).toInt(&ok_ctx);
+    auto beam = values.at(2).toUInt(&ok_beam);
+    if (!ok_threads || !ok_ctx || !ok_beam || threads == 0 || beam == 0)
+        return;
+
+    config.cpu_threads = threads;
+    config.audio_ctx_conf = static_cast<stt_engine::audio_ctx_conf_t>(ctx);
+    config.beam_search = beam;
+
+    qDebug() << "using calibrated whispercpp params:" << values;
+}
+
+bool speech_service::calibrate_stt_model(const QString &model_id,
+                                         const QString &clip_file) {
+    // models are parsed in background at startup
+    QEventLoop loop;
+    connect(
+        models_manager::instance(), &models_manager::busy_changed, &loop,
+        [&loop] {
+            if (!models_manager::instance()->busy()) loop.quit();
+        },
+        Qt::QueuedConnection);
+    if (models_manager::instance()->busy()) loop.exec();
+
+    auto model_config = choose_model_config(engine_t::stt, model_id);
+    if (!model_config || !model_config->stt ||
+        model_config->stt->engine !=
+            models_manager::model_engine_t::stt_whisper) {
+        qWarning() << "calibration is supported only for whispercpp models";
+        return false;
+    }
+
+    auto clip = audio_tools::read_wav_s16(clip_file.toStdString(), 16000);
+    if (!clip) {
+        qWarning() << "calibration clip must be 16 kHz mono s16 wav:"
+                   << clip_file;
+        return false;
+    }
+
+    stt_engine::config_t config;
+    config.model_files.model_file =
+        model_config->stt->model_file.toStdString();
+    config.lang = model_config->stt->lang_id.toStdString();
+    config.lang_code = model_config->stt->lang_code.toStdString();
+    config.options = model_config->options.toStdString();
+    config.cache_dir = settings::instance()->cache_dir().toStdString();
+
+    qDebug() << "calibrating model:" << model_config->stt->model_id;
+
+    // each cpu lib variant is calibrated and the fastest one is chosen
+    auto variants = whisper_engine::cpu_lib_variants();
+    if (variants.empty()) variants.emplace_back();
+
+    std::optional<whisper_engine::tuning_t> best_tuning;
+    std::string best_variant;
+
+    for (const auto &variant : variants) {
+        config.cpu_lib_variant = variant;
+
+        try {
+            whisper_engine engine{config, {}};
+
+            if (engine.loaded_cpu_lib_variant() != variant) {
+                qDebug() << "skipping unavailable cpu lib variant:"
+                         << QString::fromStdString(variant);
+                continue;
+            }
+
+            auto tuning = engine.calibrate(*clip, CALIBRATION_MAX_WER);
+            if (!tuning) continue;
+
+            fmt::print(
+                "variant={}, threads={}, audio-ctx={}, beam-search={}, "
+                "rtf={:.3f}, wer={:.3f}\n",
+                variant.empty() ? "default" : variant, tuning->cpu_threads,
+                tuning->audio_ctx_conf == stt_engine::audio_ctx_conf_t::dynamic
+                    ? "auto"
+                    : "default",
+                tuning->beam_search, tuning->rtf, tuning->wer);
+
+            if (!best_tuning || tuning->rtf < best_tuning->rtf) {
+                best_tuning = tuning;
+                best_variant = variant;
+            }
+        } catch (const std::runtime_error &err) {
+            qWarning() << "calibration error:" << err.what();
+        }
+    }
+
+    if (!best_tuning) {
+        qWarning() << "calibration failed";
+        return false;
+    }
+
+    auto value = QStringLiteral("%1,%2,%3")
+                     .arg(best_tuning->cpu_threads)
+                     .arg(static_cast<int>(best_tuning->audio_ctx_conf))
+                     .arg(best_tuning->beam_search);
+    if (!best_variant.empty())
+        value.append(',').append(QString::fromStdString(best_variant));
+
+    settings::instance()->set_whispercpp_tuning(
+        whispercpp_tuning_key(model_config->stt->model_id), value);
+
+    fmt::print("fastest variant: {}\n",
+               best_variant.empty() ? "default" : best_variant);
+
+    return true;
+}
+
 QString speech_service::restart_stt_engine(speech_mode_t speech_mode,
                                            const QString &model_id,
                                            const QString &out_lang_id,
-                                           const QVariantMap &options) {
+                                           const QVariantMap &options,
+                                           bool offline) {
     auto model_config = choose_model_config(engine_t::stt, model_id);
     if (model_config && model_config->stt) {
         stt_engine::config_t config;
@@ -1278,6 +1476,13 @@ QString speech_service::restart_stt_engine(speech_mode_t speech_mode,
             static_cast<stt_engine::speech_mode_t>(speech_mode);
         config.translate = !out_lang_id.isEmpty() && out_lang_id == "en" &&
                            config.lang != "en";
+        config.offline = offline;
+        config.vad_mode = static_cast<stt_engine::vad_mode_t>(
+            std::clamp(settings::instance()->stt_vad_mode(), 0,
+                       static_cast<int>(stt_engine::vad_mode_t::silero)));
+        if (config.vad_mode == stt_engine::vad_mode_t::silero)
+            config.model_files.vad_model_file =
+                settings::instance()->stt_silero_vad_model_file().toStdString();
         config.options = model_config->options.toStdString();
         config.text_format = stt_text_fromat_from_settings_format(
             static_cast<settings::text_format_t>(get_int_value_from_options(
@@ -1345,8 +1550,16 @@ QString speech_service::restart_stt_engine(speech_mode_t speech_mode,
                 // disable auto-lang with sup model
                 config.model_files.scorer_file.clear();
             }
+            config.streaming = settings::instance()->whispercpp_streaming();
+            if (!config.use_gpu)
+                apply_whispercpp_tuning(
+                    model_config->stt->model_id, config,
+                    settings::instance()->whispercpp_profile() ==
+                        settings::engine_profile_t::EngineProfilePerformance);
         } else if (model_config->stt->engine == models_manager::model_engine_t::stt_fasterwhisper) {
             ENGINE_OPTS(fasterwhisper)
+            config.batch_size = static_cast<unsigned int>(
+                std::max(0, settings::instance()->fasterwhisper_batch_size()));
         }
 #undef ENGINE_OPTS
         // clang-format on
@@ -1389,20 +1602,63 @@ QString speech_service::restart_stt_engine(speech_mode_t speech_mode,
                 return true;
             if (m_stt_engine->cpu_threads() != config.cpu_threads) return true;
             if (m_stt_engine->beam_search() != config.beam_search) return true;
+            if (m_stt_engine->vad_mode() != config.vad_mode) return true;
+            if (m_stt_engine->streaming() != config.streaming) return true;
+            if (m_stt_engine->cpu_lib_variant() != config.cpu_lib_variant)
+                return true;
+            if (m_stt_engine->batch_size() != config.batch_size) return true;
 
             return false;
         }();
 
         qDebug() << "restart stt engine config:" << config;
 
+        cached_engine_t cached{
+            [&] {
+                std::ostringstream os;
+                os << "stt:" << static_cast<int>(model_config->stt->engine)
+                   << ":" << config.model_files << ":" << config.lang << ":"
+                   << config.translate << ":" << config.use_gpu << ":"
+                   << config.gpu_device << ":" << config.audio_ctx_conf << ":"
+                   << config.audio_ctx_size << ":" << config.cpu_threads << ":"
+                   << config.beam_search << ":" << config.vad_mode << ":"
+                   << config.streaming << ":" << config.cpu_lib_variant << ":"
+                   << config.batch_size;
+                return os.str();
+            }(),
+            model_files_size({config.model_files.model_file,
+                              config.model_files.scorer_file,
+                              config.model_files.openvino_model_file})};
+
+        if (model_config->stt->engine ==
+            models_manager::model_engine_t::stt_whisper) {
+            // whisper engines with the same model and lib share loaded model
+            std::ostringstream os;
+            os << config.model_files.model_file << ":" << config.use_gpu << ":"
+               << config.gpu_device << ":" << config.cpu_lib_variant;
+            cached.model_key = os.str();
+        } else if (model_config->stt->engine ==
+                       models_manager::model_engine_t::stt_fasterwhisper &&
+                   settings::instance()->py_workers() > 0) {
+            // py worker process and its slot are released only with engine
+            cached.cacheable = false;
+        }
+
         if (new_engine_required) {
-            qDebug() << "new stt engine required";
+            park_engine(m_stt_engine, m_stt_engine_cached);
 
+            m_stt_engine = m_engines_cache.take<stt_engine>(cached.key);
             if (m_stt_engine) {
-                m_stt_engine.reset();
-                qDebug() << "stt engine destroyed successfully";
+                qDebug() << "stt engine taken from cache";
+                new_engine_required = false;
             }
 
+            m_stt_engine_cached = std::move(cached);
+        }
+
+        if (new_engine_required) {
+            qDebug() << "new stt engine required";
+
             stt_engine::callbacks_t call_backs{
                 /*text_decoded=*/[this](const std::string &text,
                                         const std::string &lang) {
@@ -1494,6 +1750,7 @@ QString speech_service::restart_stt_engine(speech_mode_t speech_mode,
         } else {
             qDebug() << "new stt engine not required, only restart";
             m_stt_engine->stop();
+            m_stt_engine->set_offline(config.offline);
             m_stt_engine->start();
             m_stt_engine->set_speech_mode(
                 static_cast<stt_engine::speech_mode_t>(speech_mode));
@@ -1761,14 +2018,34 @@ QString speech_service::restart_tts_engine(const QString &model_id,
 
         qDebug() << "restart tts engine config:" << config;
 
+        cached_engine_t cached{
+            [&] {
+                std::ostringstream os;
+                os << "tts:" << static_cast<int>(model_config->tts->engine)
+                   << ":" << config.model_files << ":" << config.speaker_id
+                   << ":" << config.lang << ":" << config.use_gpu << ":"
+                   << config.gpu_device;
+                return os.str();
+            }(),
+            model_files_size({config.model_files.model_path,
+                              config.model_files.vocoder_path,
+                              config.model_files.diacritizer_path})};
+
         if (new_engine_required) {
-            qDebug() << "new tts engine required";
+            park_engine(m_tts_engine, m_tts_engine_cached);
 
+            m_tts_engine = m_engines_cache.take<tts_engine>(cached.key);
             if (m_tts_engine) {
-                m_tts_engine.reset();
-                qDebug() << "tts engine destroyed successfully";
+                qDebug() << "tts engine taken from cache";
+                new_engine_required = false;
             }
 
+            m_tts_engine_cached = std::move(cached);
+        }
+
+        if (new_engine_required) {
+            qDebug() << "new tts engine required";
+
             tts_engine::callbacks_t call_backs{
                 /*speech_encoded=*/[this](
                                        const std::string &text,
@@ -1958,14 +2235,30 @@ QString speech_service::restart_mnt_engine(const QString &model_or_lang_id,
 
         qDebug() << "restart mnt engine config:" << config;
 
+        cached_engine_t cached{
+            [&] {
+                std::ostringstream os;
+                os << "mnt:" << config.model_files << ":" << config.lang;
+                return os.str();
+            }(),
+            model_files_size({config.model_files.model_path_first,
+                              config.model_files.model_path_second})};
+
         if (new_engine_required) {
-            qDebug() << "new mnt engine required";
+            park_engine(m_mnt_engine, m_mnt_engine_cached);
 
+            m_mnt_engine = m_engines_cache.take<mnt_engine>(cached.key);
             if (m_mnt_engine) {
-                m_tts_engine.reset();
-                qDebug() << "mnt engine destroyed successfully";
+                qDebug() << "mnt engine taken from cache";
+                new_engine_required = false;
             }
 
+            m_mnt_engine_cached = std::move(cached);
+        }
+
+        if (new_engine_required) {
+            qDebug() << "new mnt engine required";
+
             mnt_engine::callbacks_t call_backs{
                 /*text_translated=*/
                 [this](const std::string &in_text, const std::string &in_lang,
@@ -2891,21 +3184,30 @@ void speech_service::handle_audio_available() {
             return;
         }
 
-        auto [buf, max_size] = m_stt_engine->borrow_buf();
+        // move as much audio as stt engine can take, one block per iteration
+        auto max_reads = m_stt_engine->in_ring_stats().capacity + 1;
+        for (size_t i = 0; i < max_reads; ++i) {
+            auto [buf, max_size] = m_stt_engine->borrow_buf();
+
+            if (!buf) {
+                m_source->slowdown();
+                break;
+            }
 
-        if (buf) {
             auto audio_data = m_source->read_audio(buf, max_size);
 
             m_stt_engine->return_buf(buf, audio_data.size, audio_data.sof,
                                      audio_data.eof);
             set_progress(m_source->progress());
 
-            if (audio_data.eof)
+            if (audio_data.eof) {
                 m_source->slowdown();
-            else
-                m_source->speedup();
-        } else {
-            m_source->slowdown();
+                break;
+            }
+
+            m_source->speedup();
+
+            if (audio_data.size < max_size) break;  // source drained
         }
     }
 }
@@ -3404,7 +3706,8 @@ int speech_service::stt_transcribe_file(const QString &file, QString lang,
     m_current_task = {
         next_task_id(),
         engine_t::stt,
-        restart_stt_engine(speech_mode_t::automatic, lang, out_lang, options),
+        restart_stt_engine(speech_mode_t::automatic, lang, out_lang, options,
+                           /*offline=*/true),
         speech_mode_t::automatic,
         out_lang,
         0.0,
@@ -4631,6 +4934,41 @@ double speech_service::SttGetFileTranscribeProgress(int task) {
     return stt_transcribe_file_progress(task);
 }
 
+QVariantMap speech_service::SttPipelineStats() {
+    qDebug() << "[dbus => service] called SttPipelineStats";
+    m_keepalive_timer.start();
+
+    QVariantMap stats_map;
+
+    if (!m_stt_engine) return stats_map;
+
+    auto stats = m_stt_engine->stage_stats();
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const auto &stage = stats[i];
+
+        std::ostringstream name;
+        name << static_cast<stt_engine::stage_t>(i);
+
+        stats_map.insert(
+            QString::fromStdString(name.str()),
+            QVariantMap{
+                {QStringLiteral("count"),
+                 static_cast<qulonglong>(stage.count)},
+                {QStringLiteral("mean_us"),
+                 static_cast<qulonglong>(stage.mean_us())},
+                {QStringLiteral("p50_us"),
+                 static_cast<qulonglong>(stage.percentile_us(0.5))},
+                {QStringLiteral("p90_us"),
+                 static_cast<qulonglong>(stage.percentile_us(0.9))},
+                {QStringLiteral("p99_us"),
+                 static_cast<qulonglong>(stage.percentile_us(0.99))},
+                {QStringLiteral("max_us"),
+                 static_cast<qulonglong>(stage.max_us)}});
+    }
+
+    return stats_map;
+}
+
 int speech_service::KeepAliveService() {
     qDebug() << "[dbus => service] called KeepAliveService";
     m_keepalive_timer.start();
@@ -28,6 +28,7 @@
 #include "audio_source.h"
 #include "config.h"
 #include "dbus_speech_adaptor.h"
+#include "engines_cache.hpp"
 #include "mnt_engine.hpp"
 #include "models_manager.h"
 #include "singleton.h"
@@ -182,6 +183,7 @@ class speech_service : public QObject, public singleton<speech_service> {
     QVariantMap mnt_out_langs(QString in_lang) const;
     QVariantMap features_availability();
     static void remove_cached_files();
+    bool calibrate_stt_model(const QString &model_id, const QString &clip_file);
 
    signals:
     void models_changed();
@@ -365,6 +367,15 @@ class speech_service : public QObject, public singleton<speech_service> {
         std::underlying_type_t<task_flags_t> flags = task_flags_none;
     };
 
+    struct cached_engine_t {
+        std::string key;
+        size_t size = 0;
+        // engines with the same model key share loaded model
+        std::string model_key;
+        // engine holds resources that can't be kept in cache
+        bool cacheable = true;
+    };
+
     inline static const QString DBUS_SERVICE_NAME{
         QStringLiteral(APP_DBUS_SPEECH_SERVICE)};
     inline static const QString DBUS_SERVICE_PATH{QStringLiteral("/")};
@@ -375,12 +386,17 @@ class speech_service : public QObject, public singleton<speech_service> {
     static const int KEEPALIVE_TIME = 60000;           // 60s
     static const int KEEPALIVE_TASK_TIME = 10000;      // 10s
     static const int SINGLE_SENTENCE_TIMEOUT = 10000;  // 10s
+    static constexpr double CALIBRATION_MAX_WER = 0.05;
 
     int m_last_task_id = INVALID_TASK;
     std::unique_ptr<stt_engine> m_stt_engine;
     std::unique_ptr<tts_engine> m_tts_engine;
     std::unique_ptr<text_repair_engine> m_text_repair_engine;
     std::unique_ptr<mnt_engine> m_mnt_engine;
+    engines_cache<stt_engine, tts_engine, mnt_engine> m_engines_cache;
+    cached_engine_t m_stt_engine_cached;
+    cached_engine_t m_tts_engine_cached;
+    cached_engine_t m_mnt_engine_cached;
     std::unique_ptr<audio_source> m_source;
     std::map<QString, model_data_t>
         m_available_stt_models_map;  // model-id => model data
@@ -456,13 +472,16 @@ class speech_service : public QObject, public singleton<speech_service> {
     QString restart_stt_engine(speech_mode_t speech_mode,
                                const QString &model_id,
                                const QString &out_lang_id,
-                               const QVariantMap &options);
+                               const QVariantMap &options,
+                               bool offline = false);
     QString restart_tts_engine(const QString &model_id,
                                const QVariantMap &options);
     QString restart_mnt_engine(const QString &model_or_lang_id,
                                const QString &out_lang_id,
                                const QVariantMap &options);
     bool restart_text_repair_engine(const QVariantMap &options);
+    template <typename T>
+    void park_engine(std::unique_ptr<T> &engine, cached_engine_t &cached);
     struct stt_source_file_props_t {
         QString file;
         int stream_index = -1;
@@ -563,6 +582,7 @@ class speech_service : public QObject, public singleton<speech_service> {
                                       const QString &out_lang,
                                       const QVariantMap &options);
     Q_INVOKABLE double SttGetFileTranscribeProgress(int task);
+    Q_INVOKABLE QVariantMap SttPipelineStats();
     Q_INVOKABLE int TtsPlaySpeech(const QString &text, const QString &lang);
     Q_INVOKABLE int TtsPlaySpeech2(const QString &text, const QString &lang,
                                    const QVariantMap &options);
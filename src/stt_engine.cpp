@@ -10,8 +10,10 @@
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <cctype>
 #include <cstring>
 #include <iterator>
+#include <vector>
 
 #include "logger.hpp"
 
@@ -132,6 +134,9 @@ std::ostream& operator<<(std::ostream& os, stt_engine::vad_mode_t mode) {
         case stt_engine::vad_mode_t::aggressiveness3:
             os << "aggressiveness-3";
             break;
+        case stt_engine::vad_mode_t::silero:
+            os << "silero";
+            break;
     }
 
     return os;
@@ -189,11 +194,46 @@ std::ostream& operator<<(std::ostream& os,
     return os;
 }
 
+std::ostream& operator<<(std::ostream& os, stt_engine::stage_t stage) {
+    switch (stage) {
+        case stt_engine::stage_t::capture_wait:
+            os << "capture-wait";
+            break;
+        case stt_engine::stage_t::denoise:
+            os << "denoise";
+            break;
+        case stt_engine::stage_t::vad:
+            os << "vad";
+            break;
+        case stt_engine::stage_t::queue:
+            os << "queue";
+            break;
+        case stt_engine::stage_t::inference:
+            os << "inference";
+            break;
+        case stt_engine::stage_t::encoder:
+            os << "encoder";
+            break;
+        case stt_engine::stage_t::decoder:
+            os << "decoder";
+            break;
+        case stt_engine::stage_t::punctuation:
+            os << "punctuation";
+            break;
+        case stt_engine::stage_t::callback:
+            os << "callback";
+            break;
+    }
+
+    return os;
+}
+
 std::ostream& operator<<(std::ostream& os,
                          const stt_engine::model_files_t& model_files) {
     os << "model-file=" << model_files.model_file
        << ", scorer-file=" << model_files.scorer_file
        << ", openvino-file=" << model_files.openvino_model_file
+       << ", vad-model-file=" << model_files.vad_model_file
        << ", ttt-model-file=" << model_files.ttt_model_file;
 
     return os;
@@ -218,6 +258,14 @@ std::ostream& operator<<(std::ostream& os,
     return os;
 }
 
+std::ostream& operator<<(std::ostream& os,
+                         const stt_engine::in_ring_stats_t& stats) {
+    os << "capacity=" << stats.capacity << ", filled=" << stats.filled
+       << ", overruns=" << stats.overruns;
+
+    return os;
+}
+
 std::ostream& operator<<(std::ostream& os, const stt_engine::config_t& config) {
     os << "lang=" << config.lang << ", lang_code=" << config.lang_code
        << ", model-files=[" << config.model_files
@@ -236,12 +284,33 @@ std::ostream& operator<<(std::ostream& os, const stt_engine::config_t& config) {
        << config.gpu_device << "]"
        << ", sub-config=[" << config.sub_config << "]"
        << ", translate=" << config.translate
+       << ", offline=" << config.offline
+       << ", streaming=" << config.streaming
+       << ", cpu-lib-variant=" << config.cpu_lib_variant
+       << ", batch-size=" << config.batch_size
        << ", initial_prompt=" << config.initial_prompt.empty();
     return os;
 }
 
+static vad::config_t make_vad_config(const stt_engine::config_t& config) {
+    vad::config_t vad_config;
+
+    if (config.vad_mode == stt_engine::vad_mode_t::silero) {
+        vad_config.backend_type = vad::backend_type_t::silero;
+        vad_config.model_file = config.model_files.vad_model_file;
+    } else {
+        vad_config.webrtc_mode = static_cast<int>(config.vad_mode);
+    }
+
+    return vad_config;
+}
+
 stt_engine::stt_engine(config_t config, callbacks_t call_backs)
-    : m_config{std::move(config)}, m_call_backs{std::move(call_backs)} {}
+    : m_config{std::move(config)},
+      m_call_backs{std::move(call_backs)},
+      m_vad{make_vad_config(m_config)} {
+    m_in_ring.reset();
+}
 
 stt_engine::~stt_engine() { LOGD("stt dtor"); }
 
@@ -258,6 +327,7 @@ void stt_engine::start() {
 
     m_thread_exit_requested = false;
     reset_segment_counters();
+    m_in_ring.reset();
 
     m_processing_thread = std::thread{&stt_engine::process, this};
 
@@ -314,14 +384,15 @@ void stt_engine::process() {
 
     m_thread_exit_requested = false;
 
+    m_thread_lease = cpu_tools::acquire_threads(m_config.cpu_threads);
+    m_thread_lease.pin_current_thread();
+
     try {
         set_state(state_t::initializing);
         start_processing_impl();
         set_state(state_t::idle);
 
         while (true) {
-            std::unique_lock lock{m_processing_mtx};
-
             if (m_thread_exit_requested) break;
 
             if (m_restart_requested) {
@@ -329,9 +400,18 @@ void stt_engine::process() {
                 flush(flush_t::restart);
             }
 
-            if (process_buff() == samples_process_result_t::wait_for_samples &&
-                !m_thread_exit_requested)
+            auto result = process_buff();
+
+            // not held while processing, engine may wait there for threads
+            // that call notify_processing()
+            std::unique_lock lock{m_processing_mtx};
+
+            if (result == samples_process_result_t::wait_for_samples &&
+                !m_processing_notified && !m_thread_exit_requested &&
+                m_in_ring.empty())
                 m_processing_cv.wait(lock);
+
+            m_processing_notified = false;
         }
 
         flush(flush_t::exit);
@@ -343,11 +423,22 @@ void stt_engine::process() {
 
     reset_in_processing();
 
+    m_thread_lease = {};
+
     LOGD("stt processing ended");
 
     if (m_call_backs.stopped) m_call_backs.stopped();
 }
 
+void stt_engine::notify_processing() {
+    {
+        std::lock_guard lock{m_processing_mtx};
+        m_processing_notified = true;
+    }
+
+    m_processing_cv.notify_one();
+}
+
 bool stt_engine::lock_buf(lock_type_t desired_lock) {
     lock_type_t expected_lock = lock_type_t::free;
     return m_in_buf.lock.compare_exchange_strong(expected_lock, desired_lock);
@@ -367,64 +458,144 @@ std::pair<char*, size_t> stt_engine::borrow_buf() {
         return c_buf;
     }
 
-    if (!lock_buf(lock_type_t::borrowed)) {
-        LOGT("failed to lock for borrowing");
-        return c_buf;
-    }
+    auto head = m_in_ring.head.load(std::memory_order_relaxed);
+    auto tail = m_in_ring.tail.load(std::memory_order_acquire);
 
-    if (m_in_buf.full()) {
-        LOGD("in-buf is full");
-        free_buf();
+    if (head - tail >= m_in_ring_size) {
+        auto overruns =
+            m_in_ring.overruns.fetch_add(1, std::memory_order_relaxed) + 1;
+        LOGD("in-ring is full: overruns=" << overruns);
         m_processing_cv.notify_one();
         return c_buf;
     }
 
-    c_buf.first = reinterpret_cast<char*>(&m_in_buf.buf.at(m_in_buf.size));
-    c_buf.second = (m_in_buf.buf.size() - m_in_buf.size) *
-                   sizeof(in_buf_t::buf_t::value_type);
+    auto& slot = m_in_ring.blocks[head % m_in_ring_size];
+
+    c_buf.first = reinterpret_cast<char*>(slot.buf.data() + slot.size);
+    c_buf.second =
+        (slot.buf.size() - slot.size) * sizeof(in_buf_t::buf_t::value_type);
+
+    m_in_ring.borrowed = true;
 
     return c_buf;
 }
 
 void stt_engine::return_buf(const char* c_buf, size_t size, bool sof,
                             bool eof) {
-    if (m_in_buf.lock != lock_type_t::borrowed) return;
+    if (!m_in_ring.borrowed) return;
+
+    m_in_ring.borrowed = false;
 
     LOGT("lock buff returned: sof=" << sof << ", eof=" << eof
                                     << ", buf size=" << size);
 
-    m_in_buf.size =
-        (c_buf - reinterpret_cast<char*>(m_in_buf.buf.data()) + size) /
-        sizeof(in_buf_t::buf_t::value_type);
-    m_in_buf.eof = eof;
-    if (sof) m_in_buf.sof = sof;
+    auto head = m_in_ring.head.load(std::memory_order_relaxed);
+    auto& slot = m_in_ring.blocks[head % m_in_ring_size];
+
+    if (slot.size == 0) slot.time = std::chrono::steady_clock::now();
+    slot.size = (c_buf - reinterpret_cast<char*>(slot.buf.data()) + size) /
+                sizeof(in_buf_t::buf_t::value_type);
+    slot.eof = eof;
+    if (sof) slot.sof = sof;
+
+    // publish slot to processing thread
+    if (slot.size >= m_in_buf_publish_size || slot.eof)
+        m_in_ring.head.store(head + 1, std::memory_order_release);
 
-    free_buf();
     m_processing_cv.notify_one();
 }
 
+bool stt_engine::pop_in_ring() {
+    auto tail = m_in_ring.tail.load(std::memory_order_relaxed);
+    auto head = m_in_ring.head.load(std::memory_order_acquire);
+
+    if (tail == head) return false;
+
+    auto& slot = m_in_ring.blocks[tail % m_in_ring_size];
+
+    std::copy(slot.buf.cbegin(), slot.buf.cbegin() + slot.size,
+              m_in_buf.buf.begin());
+    m_in_buf.size = slot.size;
+    m_in_buf.eof = slot.eof;
+    if (slot.sof) m_in_buf.sof = true;
+    if (slot.size > 0) record_stage(stage_t::capture_wait, slot.time);
+
+    slot.clear();
+
+    m_in_ring.tail.store(tail + 1, std::memory_order_release);
+
+    return true;
+}
+
+stt_engine::in_ring_stats_t stt_engine::in_ring_stats() const {
+    return {m_in_ring_size, m_in_ring.filled(),
+            m_in_ring.overruns.load(std::memory_order_relaxed)};
+}
+
+stt_engine::stage_stats_t stt_engine::stage_stats() const {
+    stage_stats_t stats;
+    for (size_t i = 0; i < stage_count; ++i)
+        stats[i] = m_stage_stats[i].snapshot();
+    return stats;
+}
+
+void stt_engine::record_stage(stage_t stage,
+                              std::chrono::steady_clock::time_point start) {
+    record_stage(stage, std::chrono::steady_clock::now() - start);
+}
+
+void stt_engine::record_stage(stage_t stage,
+                              std::chrono::steady_clock::duration duration) {
+    m_stage_stats[static_cast<size_t>(stage)].add(duration);
+}
+
+void stt_engine::denoise_in_buf() {
+    auto start = std::chrono::steady_clock::now();
+    m_denoiser.process(m_in_buf.buf.data(), m_in_buf.size);
+    record_stage(stage_t::denoise, start);
+}
+
+const vad::buf_t& stt_engine::remove_silence_from_in_buf() {
+    auto start = std::chrono::steady_clock::now();
+    const auto& buf = m_vad.remove_silence(m_in_buf.buf.data(), m_in_buf.size);
+    record_stage(stage_t::vad, start);
+    return buf;
+}
+
+std::string stt_engine::punctuate(const std::string& text) {
+    if (!m_punctuator) return text;
+
+    auto start = std::chrono::steady_clock::now();
+    auto result = m_punctuator->process(text);
+    record_stage(stage_t::punctuation, start);
+    return result;
+}
+
 bool stt_engine::lock_buff_for_processing() {
     if (!lock_buf(lock_type_t::processed)) {
         LOGT("failed to lock for processing");
         return false;
     }
 
-    LOGT("lock buff for processing: sof=" << m_in_buf.sof
-                                          << ", eof=" << m_in_buf.eof
-                                          << ", buf size=" << m_in_buf.size);
-
-    if (!m_in_buf.eof && m_in_buf.size < m_in_buf_max_size) {
+    if (!m_in_buf.eof && m_in_buf.size < m_in_buf_max_size && !pop_in_ring()) {
         free_buf();
         return false;
     }
 
+    LOGT("lock buff for processing: sof=" << m_in_buf.sof
+                                          << ", eof=" << m_in_buf.eof
+                                          << ", buf size=" << m_in_buf.size
+                                          << ", in-ring=[" << in_ring_stats()
+                                          << "]");
+
     return true;
 }
 
 void stt_engine::reset_in_processing() {
-    LOGD("reset in processing");
+    LOGD("reset in processing: in-ring=[" << in_ring_stats() << "]");
 
     m_in_buf.clear();
+    while (pop_in_ring()) m_in_buf.clear();
     m_start_time.reset();
     m_vad.reset();
     m_intermediate_text.reset();
@@ -437,31 +608,77 @@ stt_engine::samples_process_result_t stt_engine::process_buff() {
     return samples_process_result_t::wait_for_samples;
 }
 
-std::string stt_engine::merge_texts(const std::string& old_text,
-                                    std::string&& new_text) {
-    if (new_text.empty()) return old_text;
+size_t stt_engine::text_overlap(std::string_view old_text,
+                                std::string_view new_text) {
+    auto size = std::min(old_text.size(), new_text.size());
+    if (size == 0) return 0;
+
+    // kmp search of new text prefix in old text tail
+    auto pattern = new_text.substr(0, size);
+    std::vector<size_t> prefix(size, 0);
+    for (size_t i = 1, k = 0; i < size; ++i) {
+        while (k > 0 && pattern[i] != pattern[k]) k = prefix[k - 1];
+        if (pattern[i] == pattern[k]) ++k;
+        prefix[i] = k;
+    }
 
-    if (old_text.empty()) return std::move(new_text);
+    size_t k = 0;
+    for (auto c : old_text.substr(old_text.size() - size)) {
+        while (k > 0 && (k == size || c != pattern[k])) k = prefix[k - 1];
+        if (c == pattern[k]) ++k;
+    }
+
+    return k;
+}
 
-    size_t i = 1, idx = 0;
-    auto l = std::min(old_text.size(), new_text.size());
-    for (; i <= l; ++i) {
-        auto beg = old_text.cend();
-        std::advance(beg, 0 - i);
+bool stt_engine::merge_text_into(std::string& text, std::string&& new_text) {
+    if (new_text.empty()) return false;
 
-        auto end = new_text.cbegin();
-        std::advance(end, i);
+    if (text.empty()) {
+        text = std::move(new_text);
+        return true;
+    }
 
-        if (std::equal(beg, old_text.cend(), new_text.cbegin(), end)) idx = i;
+    std::string_view delta{new_text};
+    if (auto overlap = text_overlap(text, new_text); overlap > 0) {
+        delta.remove_prefix(overlap);
+        while (!delta.empty() &&
+               std::isspace(static_cast<unsigned char>(delta.front())))
+            delta.remove_prefix(1);
     }
 
-    if (idx > 0) {
-        new_text = new_text.substr(idx);
-        ltrim(new_text);
+    if (delta.empty()) return false;
+
+    text.reserve(text.size() + delta.size() + 1);
+    text.push_back(' ');
+    text.append(delta);
+
+    return true;
+}
+
+std::string stt_engine::merge_texts(const std::string& old_text,
+                                    std::string&& new_text) {
+    auto text = old_text;
+    merge_text_into(text, std::move(new_text));
+    return text;
+}
+
+void stt_engine::merge_intermediate_text(std::string&& text,
+                                         const std::string& lang) {
+    if (m_intermediate_text) {
+        if (!merge_text_into(*m_intermediate_text, std::move(text))) return;
+    } else {
+        m_intermediate_text = std::move(text);
     }
 
-    if (new_text.empty()) return old_text;
-    return old_text + " " + new_text;
+    m_intermediate_lang = lang;
+    if (m_intermediate_text->empty() ||
+        m_intermediate_text->size() >= m_min_text_size) {
+        auto start = std::chrono::steady_clock::now();
+        m_call_backs.intermediate_text_decoded(m_intermediate_text.value(),
+                                               m_intermediate_lang);
+        record_stage(stage_t::callback, start);
+    }
 }
 
 void stt_engine::set_intermediate_text(const std::string& text,
@@ -471,8 +688,10 @@ void stt_engine::set_intermediate_text(const std::string& text,
         m_intermediate_lang = lang;
         if (m_intermediate_text->empty() ||
             m_intermediate_text->size() >= m_min_text_size) {
+            auto start = std::chrono::steady_clock::now();
             m_call_backs.intermediate_text_decoded(m_intermediate_text.value(),
                                                    m_intermediate_lang);
+            record_stage(stage_t::callback, start);
         }
     }
 }
@@ -528,8 +747,10 @@ void stt_engine::flush(flush_t type) {
         if ((type == flush_t::regular || type == flush_t::eof ||
              m_config.speech_mode != speech_mode_t::single_sentence) &&
             m_intermediate_text->size() >= m_min_text_size) {
+            auto start = std::chrono::steady_clock::now();
             m_call_backs.text_decoded(m_intermediate_text.value(),
                                       m_intermediate_lang);
+            record_stage(stage_t::callback, start);
 
             if (m_config.speech_mode == speech_mode_t::single_sentence) {
                 set_speech_started(false);
@@ -19,10 +19,13 @@
 #include <optional>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <utility>
 
+#include "cpu_tools.hpp"
 #include "denoiser.hpp"
+#include "latency_histogram.hpp"
 #include "punctuator.hpp"
 #include "vad.hpp"
 
@@ -46,7 +49,8 @@ class stt_engine {
         aggressiveness0 = 0,
         aggressiveness1 = 1,
         aggressiveness2 = 2,
-        aggressiveness3 = 3
+        aggressiveness3 = 3,
+        silero = 4
     };
     friend std::ostream& operator<<(std::ostream& os, vad_mode_t mode);
 
@@ -60,17 +64,45 @@ class stt_engine {
     friend std::ostream& operator<<(std::ostream& os,
                                     text_format_t text_format);
 
+    // pipeline stages with measured latency
+    enum class stage_t {
+        capture_wait = 0, /*audio waiting in in-ring*/
+        denoise,
+        vad,
+        queue, /*speech waiting for free decoder*/
+        inference,
+        encoder, /*whisper encoder part of inference*/
+        decoder, /*whisper decoder part of inference*/
+        punctuation,
+        callback
+    };
+    friend std::ostream& operator<<(std::ostream& os, stage_t stage);
+    inline static const size_t stage_count =
+        static_cast<size_t>(stage_t::callback) + 1;
+    using stage_stats_t =
+        std::array<latency_histogram::snapshot_t, stage_count>;
+
+    struct in_ring_stats_t {
+        size_t capacity = 0;
+        size_t filled = 0;
+        size_t overruns = 0;
+    };
+    friend std::ostream& operator<<(std::ostream& os,
+                                    const in_ring_stats_t& stats);
+
     struct model_files_t {
         std::string model_file;
         std::string scorer_file;
         std::string ttt_model_file;
         std::string openvino_model_file; /* used only in whisper.cpp */
+        std::string vad_model_file;      /* used only with silero vad */
 
         bool operator==(const model_files_t& rhs) const {
             return model_file == rhs.model_file &&
                    scorer_file == rhs.scorer_file &&
                    ttt_model_file == rhs.ttt_model_file &&
-                   openvino_model_file == rhs.openvino_model_file;
+                   openvino_model_file == rhs.openvino_model_file &&
+                   vad_model_file == rhs.vad_model_file;
         };
         bool operator!=(const model_files_t& rhs) const {
             return !(*this == rhs);
@@ -127,6 +159,8 @@ class stt_engine {
         speech_mode_t speech_mode = speech_mode_t::automatic;
         vad_mode_t vad_mode = vad_mode_t::aggressiveness3;
         bool translate = false; /*extra whisper feature*/
+        bool offline = false;   /*audio from file, not realtime*/
+        bool streaming = false; /*extra whisper feature*/
         bool speech_started = false;
         bool insert_stats = false;
         bool use_gpu = false;
@@ -137,6 +171,8 @@ class stt_engine {
             audio_ctx_conf_t::dynamic; /*extra whisper feature*/
         int audio_ctx_size = 1500;     /*extra whisper feature*/
         std::string initial_prompt;    /*extra whisper feature*/
+        std::string cpu_lib_variant;   /*extra whisper feature*/
+        unsigned int batch_size = 0;   /*extra fasterwhisper feature*/
         text_format_t text_format = text_format_t::raw;
         std::string options;
         gpu_device_t gpu_device;
@@ -161,6 +197,7 @@ class stt_engine {
     speech_detection_status_t speech_detection_status() const;
     void set_speech_mode(speech_mode_t mode);
     auto speech_mode() const { return m_config.speech_mode; }
+    auto vad_mode() const { return m_config.vad_mode; }
     void set_speech_started(bool value);
     auto speech_status() const { return m_config.speech_started; }
     const model_files_t& model_files() const { return m_config.model_files; }
@@ -170,6 +207,10 @@ class stt_engine {
     auto gpu_device() const { return m_config.gpu_device; }
     auto text_format() const { return m_config.text_format; }
     void set_text_format(text_format_t value) { m_config.text_format = value; }
+    auto offline() const { return m_config.offline; }
+    auto streaming() const { return m_config.streaming; }
+    auto cpu_lib_variant() const { return m_config.cpu_lib_variant; }
+    void set_offline(bool value) { m_config.offline = value; }
     void set_sub_config(sub_config_t value) { m_config.sub_config = value; }
     bool stop_requested() const { return m_thread_exit_requested; }
     void set_insert_stats(bool value) { m_config.insert_stats = value; }
@@ -177,10 +218,13 @@ class stt_engine {
     auto audio_ctx_size() const { return m_config.audio_ctx_size; }
     auto cpu_threads() const { return m_config.cpu_threads; }
     auto beam_search() const { return m_config.beam_search; }
+    auto batch_size() const { return m_config.batch_size; }
     auto initial_prompt() const { return m_config.initial_prompt; }
     void set_initial_prompt(std::string prompt) {
         m_config.initial_prompt.assign(std::move(prompt));
     }
+    in_ring_stats_t in_ring_stats() const;
+    stage_stats_t stage_stats() const;
 
    protected:
     enum class lock_type_t { free, processed, borrowed };
@@ -198,6 +242,7 @@ class stt_engine {
 
     inline static const size_t m_sample_rate = 16000;  // 1s
     inline static const size_t m_in_buf_max_size = 24000;
+    inline static const size_t m_in_ring_size = 8;  // 8 x 1.5s
     inline static const size_t m_speech_max_size = m_sample_rate * 60;  // 60s
     inline static const unsigned int m_min_text_size = 4;
     inline static const auto m_timeout = 10s;
@@ -208,6 +253,7 @@ class stt_engine {
         buf_t::size_type size = 0;
         bool sof = true;
         bool eof = false;
+        std::chrono::steady_clock::time_point time;  // first sample in slot
         std::atomic<lock_type_t> lock = lock_type_t::free;
         [[nodiscard]] bool full() const { return size == buf.size(); }
         void clear() {
@@ -217,15 +263,40 @@ class stt_engine {
         }
     };
 
+    // Single-producer single-consumer ring of audio blocks. Producer (audio
+    // source) fills slot at 'head', consumer (processing thread) takes slot at
+    // 'tail'. Slot is published when it is full or has eof.
+    struct in_ring_t {
+        std::array<in_buf_t, m_in_ring_size> blocks;
+        std::atomic<size_t> head = 0;
+        std::atomic<size_t> tail = 0;
+        std::atomic<size_t> overruns = 0;
+        bool borrowed = false;
+        [[nodiscard]] size_t filled() const { return head - tail; }
+        [[nodiscard]] bool empty() const { return filled() == 0; }
+        void reset() {
+            for (auto& slot : blocks) slot.clear();
+            head = 0;
+            tail = 0;
+            overruns = 0;
+            borrowed = false;
+        }
+    };
+
     config_t m_config;
     callbacks_t m_call_backs;
     std::thread m_processing_thread;
+    cpu_tools::thread_lease m_thread_lease;  // valid in processing thread
     std::mutex m_processing_mtx;
     std::condition_variable m_processing_cv;
+    bool m_processing_notified = false;  // guarded by m_processing_mtx
     bool m_thread_exit_requested = false;
     in_buf_t m_in_buf;
+    in_ring_t m_in_ring;
+    size_t m_in_buf_publish_size = m_in_buf_max_size;  // set before start
     std::optional<std::string> m_intermediate_text;
     std::string m_intermediate_lang;
+    std::array<latency_histogram, stage_count> m_stage_stats;
     vad m_vad;
     denoiser m_denoiser{16000, denoiser::task_flags::task_denoise_hard |
                                    denoiser::task_flags::task_normalize};
@@ -242,6 +313,11 @@ class stt_engine {
 
     static void ltrim(std::string& s);
     static void rtrim(std::string& s);
+    // length of the longest old text suffix that is new text prefix
+    static size_t text_overlap(std::string_view old_text,
+                               std::string_view new_text);
+    // appends new text without overlap, returns false when nothing added
+    static bool merge_text_into(std::string& text, std::string&& new_text);
     static std::string merge_texts(const std::string& old_text,
                                    std::string&& new_text);
     virtual samples_process_result_t process_buff();
@@ -253,11 +329,23 @@ class stt_engine {
     void flush(flush_t type);
     bool lock_buf(lock_type_t desired_lock);
     bool lock_buff_for_processing();
+    bool pop_in_ring();
     void free_buf(lock_type_t lock);
     void free_buf();
+    // wakes processing thread, notification is not lost when it is busy
+    void notify_processing();
     void set_speech_detection_status(speech_detection_status_t status);
     void set_intermediate_text(const std::string& text,
                                const std::string& lang);
+    void record_stage(stage_t stage,
+                      std::chrono::steady_clock::time_point start);
+    void record_stage(stage_t stage,
+                      std::chrono::steady_clock::duration duration);
+    void denoise_in_buf();
+    const vad::buf_t& remove_silence_from_in_buf();
+    std::string punctuate(const std::string& text);
+    // merges text into intermediate text in place
+    void merge_intermediate_text(std::string&& text, const std::string& lang);
     void set_state(state_t new_state);
     void reset_in_processing();
     void process();
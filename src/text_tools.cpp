@@ -1216,4 +1216,49 @@ processor::~processor() {
     if (task) task->get();
 }
 
+static std::vector<std::string> normalized_words(const std::string& text) {
+    std::vector<std::string> words;
+
+    std::istringstream is{text};
+    for (std::string word; is >> word;) {
+        word.erase(std::remove_if(word.begin(), word.end(),
+                                  [](unsigned char c) {
+                                      return std::ispunct(c) != 0;
+                                  }),
+                   word.end());
+        if (word.empty()) continue;
+        std::transform(word.begin(), word.end(), word.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        words.push_back(std::move(word));
+    }
+
+    return words;
+}
+
+double word_error_rate(const std::string& ref, const std::string& hyp) {
+    auto ref_words = normalized_words(ref);
+    auto hyp_words = normalized_words(hyp);
+
+    if (ref_words.empty()) return hyp_words.empty() ? 0.0 : 1.0;
+
+    // levenshtein distance over words, single row
+    std::vector<size_t> row(hyp_words.size() + 1);
+    for (size_t j = 0; j < row.size(); ++j) row[j] = j;
+
+    for (size_t i = 1; i <= ref_words.size(); ++i) {
+        auto diag = row[0];
+        row[0] = i;
+        for (size_t j = 1; j <= hyp_words.size(); ++j) {
+            auto up = row[j];
+            row[j] = std::min(
+                {up + 1, row[j - 1] + 1,
+                 diag + (ref_words[i - 1] == hyp_words[j - 1] ? 0 : 1)});
+            diag = up;
+        }
+    }
+
+    return static_cast<double>(row.back()) /
+           static_cast<double>(ref_words.size());
+}
+
 }  // namespace text_tools
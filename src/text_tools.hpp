@@ -111,6 +111,8 @@ void break_segment_to_multiline(unsigned int min_line_size,
 void break_segments_to_multiline(unsigned int min_line_size,
                                  unsigned int max_line_size,
                                  std::vector<segment_t>& segments);
+// word-level edit distance divided by number of words in reference
+double word_error_rate(const std::string& ref, const std::string& hyp);
 }  // namespace text_tools
 
 #endif  // TEXT_TOOLS_H
@@ -10,26 +10,94 @@
 #include <webrtc_vad.h>
 
 #include <algorithm>
-#include <numeric>
 #include <stdexcept>
 #include <vector>
 
 #include "logger.hpp"
+#include "silero_vad.hpp"
 
-vad::vad() { restart(); }
+namespace {
+class webrtc_vad : public vad::backend {
+   public:
+    explicit webrtc_vad(int mode) : m_mode{mode} { restart(); }
 
-void vad::restart() {
-    if (m_handle) WebRtcVad_Free(m_handle);
+    ~webrtc_vad() override {
+        if (m_handle) WebRtcVad_Free(m_handle);
+    }
+
+    size_t chunk_size() const override { return 480; }  // 30 ms
+
+    void restart() override {
+        if (m_handle) WebRtcVad_Free(m_handle);
+
+        m_handle = WebRtcVad_Create();
+
+        if (m_handle == nullptr) throw std::runtime_error("vad create error");
+
+        if (WebRtcVad_Init(m_handle) != 0)
+            throw std::runtime_error("vad init error");
+
+        if (WebRtcVad_set_mode(m_handle, m_mode) != 0)
+            throw std::runtime_error("set mode error");
+    }
+
+    bool is_speech_chunk(const vad::buf_t::value_type* chunk) override {
+        auto result = WebRtcVad_Process(m_handle, m_fs, chunk, chunk_size());
+
+        if (result < 0) throw std::runtime_error("process error");
+
+        return result == 1;
+    }
+
+   private:
+    WebRtcVadInst* m_handle = nullptr;
+    int m_mode = 3;
+    int m_fs = 16000;
+};
+}  // namespace
+
+std::ostream& operator<<(std::ostream& os, vad::backend_type_t type) {
+    switch (type) {
+        case vad::backend_type_t::webrtc:
+            os << "webrtc";
+            break;
+        case vad::backend_type_t::silero:
+            os << "silero";
+            break;
+    }
+
+    return os;
+}
+
+vad::vad() : vad{config_t{}} {}
+
+vad::vad(config_t config) : m_config{std::move(config)} {
+    create_backend();
+    reset();
+}
+
+void vad::create_backend() {
+    if (m_config.backend_type == backend_type_t::silero) {
+        try {
+            m_backend = std::make_unique<silero_vad>(m_config.model_file,
+                                                     m_config.threshold);
+        } catch (const std::runtime_error& err) {
+            LOGE("failed to create silero vad, using webrtc: " << err.what());
+            m_config.backend_type = backend_type_t::webrtc;
+        }
+    }
 
-    m_handle = WebRtcVad_Create();
+    if (!m_backend)
+        m_backend = std::make_unique<webrtc_vad>(m_config.webrtc_mode);
 
-    if (m_handle == nullptr) throw std::runtime_error("vad create error");
+    m_chunk_size = m_backend->chunk_size();
 
-    if (WebRtcVad_Init(m_handle) != 0)
-        throw std::runtime_error("vad init error");
+    LOGD("vad backend: " << m_config.backend_type
+                         << ", chunk size=" << m_chunk_size);
+}
 
-    if (WebRtcVad_set_mode(m_handle, m_mode) != 0)
-        throw std::runtime_error("set mode error");
+void vad::restart() {
+    m_backend->restart();
 
     reset();
 }
@@ -37,10 +105,12 @@ void vad::restart() {
 void vad::reset() {
     m_output_samples.clear();
     m_input_samples.clear();
-    m_dup_size = 0;
+    m_speech_chunks_acc.assign(1, 0);
+    m_window = 0;
+    m_cut_start.reset();
 }
 
-vad::~vad() { WebRtcVad_Free(m_handle); }
+vad::~vad() = default;
 
 void vad::shift_left(std::vector<int16_t>& vec, size_t distance) {
     if (distance >= vec.size()) {
@@ -73,23 +143,28 @@ static void insert_to_vec(const std::vector<int16_t>& input, size_t start,
     output.insert(output.end(), beg, end);
 }
 
-std::vector<bool> vad::vad_process(const buf_t& samples) const {
-    const auto chunks = samples.size() / m_chunk_size;
+void vad::vad_process() {
+    const auto chunks = m_input_samples.size() / m_chunk_size;
 
-    std::vector<bool> results;
-    results.reserve(chunks);
+    // only chunks not classified yet are passed to the backend
+    for (auto chunk = m_speech_chunks_acc.size() - 1; chunk < chunks; ++chunk) {
+        auto speech = m_backend->is_speech_chunk(m_input_samples.data() +
+                                                 (chunk * m_chunk_size));
 
-    for (size_t chunk = 0; chunk < chunks; ++chunk) {
-        auto result = WebRtcVad_Process(m_handle, m_fs,
-                                        samples.data() + (chunk * m_chunk_size),
-                                        m_chunk_size);
+        m_speech_chunks_acc.push_back(m_speech_chunks_acc.back() +
+                                      (speech ? 1 : 0));
+    }
+}
 
-        if (result < 0) throw std::runtime_error("process error");
+void vad::trim_input(size_t distance) {
+    shift_left(m_input_samples, distance);
 
-        results.push_back(result == 1);
-    }
+    auto beg = m_speech_chunks_acc.begin();
+    std::advance(beg, distance / m_chunk_size);
+    m_speech_chunks_acc.erase(m_speech_chunks_acc.begin(), beg);
 
-    return results;
+    auto removed = m_speech_chunks_acc.front();
+    for (auto& acc : m_speech_chunks_acc) acc -= removed;
 }
 
 bool vad::is_speech(const buf_t::value_type* frame, size_t frame_size) {
@@ -100,92 +175,63 @@ const vad::buf_t& vad::remove_silence(const buf_t::value_type* frame,
                                       size_t frame_size) {
     m_output_samples.clear();
 
-    for (size_t i = 0; i < frame_size; ++i) m_input_samples.push_back(frame[i]);
-
-    if (m_input_samples.size() < m_chunk_size) return m_output_samples;
+    m_input_samples.insert(m_input_samples.end(), frame, frame + frame_size);
 
     LOGT("input samples: size=" << m_input_samples.size());
 
-    auto vad_results = vad_process(m_input_samples);
-
-    if (vad_results.size() < m_chunks_in_frame) return m_output_samples;
-
-    std::optional<size_t> cut_start;
-    std::optional<size_t> cut_stop;
-
-    for (size_t chunk = 0; chunk <= (vad_results.size() - m_chunks_in_frame);
-         ++chunk) {
-        auto beg = vad_results.cbegin();
-        std::advance(beg, chunk);
+    // vad backends are stateful, so each chunk must be classified only once
+    vad_process();
 
-        auto end = beg;
-        std::advance(end, m_chunks_in_frame);
+    const auto chunks = m_speech_chunks_acc.size() - 1;
 
-        auto acc = std::accumulate(beg, end, static_cast<size_t>(0),
-                                   [](size_t sum, bool value) {
-                                       if (value) ++sum;
-                                       return sum;
-                                   });
+    // each window is checked only once, so output doesn't depend on frame size
+    for (; m_window + m_chunks_in_frame <= chunks; ++m_window) {
+        // number of speech chunks in the window
+        auto acc = m_speech_chunks_acc[m_window + m_chunks_in_frame] -
+                   m_speech_chunks_acc[m_window];
 
         auto vad_active = 2 * acc > m_chunks_in_frame;
 
-        if (vad_active && !cut_start) {
-            auto pos = std::min(chunk * m_chunk_size, m_input_samples.size());
-            LOGT("cut start: pos=" << pos << ", m_dup_size=" << m_dup_size);
+        if (vad_active && !m_cut_start) {
+            m_cut_start.emplace(m_window * m_chunk_size);
 
-            if (pos == 0) {
-                pos = std::min(pos + m_dup_size, m_input_samples.size());
-                m_dup_size = 0;
-            }
-
-            cut_start.emplace(pos);
-
-            LOGT("cut start: " << *cut_start << ", chunk=" << chunk
+            LOGT("cut start: " << *m_cut_start << ", chunk=" << m_window
                                << ", m_chunk_size=" << m_chunk_size);
         }
 
-        if (!vad_active && cut_start) {
-            auto pos = std::min((chunk + m_chunks_in_frame) * m_chunk_size,
-                                m_input_samples.size());
-            LOGT("cut stop: pos=" << pos);
-
-            if (pos > *cut_start) {
-                cut_stop.emplace(pos);
+        if (!vad_active && m_cut_start) {
+            auto cut_stop = (m_window + m_chunks_in_frame) * m_chunk_size;
 
-                LOGT("cut stop: " << *cut_stop << ", chunk=" << chunk
-                                  << ", m_chunk_size=" << m_chunk_size);
+            LOGT("cut stop: " << cut_stop << ", chunk=" << m_window
+                              << ", m_chunk_size=" << m_chunk_size);
 
-                insert_to_vec(m_input_samples, *cut_start, *cut_stop,
-                              m_output_samples);
+            insert_to_vec(m_input_samples, *m_cut_start, cut_stop,
+                          m_output_samples);
 
-                cut_start.reset();
-                chunk += m_chunks_in_frame;
-            }
+            m_cut_start.reset();
+            m_window += m_chunks_in_frame;
         }
     }
 
-    m_dup_size = 0;
+    if (m_cut_start) {
+        // speech continues, classified samples are returned right away
+        auto cut_stop = chunks * m_chunk_size;
 
-    auto dup_size = m_input_samples.size() <= m_dup_max_size
-                        ? m_dup_max_size - m_input_samples.size()
-                        : m_dup_max_size;
+        LOGT("cut stop: " << cut_stop);
 
-    if (cut_start) {
-        cut_stop.emplace(m_input_samples.size());
+        insert_to_vec(m_input_samples, *m_cut_start, cut_stop,
+                      m_output_samples);
 
-        LOGT("cut stop: " << *cut_stop);
-
-        insert_to_vec(m_input_samples, *cut_start, *cut_stop, m_output_samples);
+        m_cut_start.emplace(cut_stop);
     }
 
-    if (cut_stop) {
-        auto not_cut = m_input_samples.size() - *cut_stop;
-        if (not_cut < dup_size) m_dup_size = dup_size - not_cut;
-    }
+    // chunks before next window are not needed anymore
+    auto distance = std::min(m_window, chunks);
 
-    LOGT("dup: added size=" << dup_size << ", to remove size=" << m_dup_size);
+    trim_input(distance * m_chunk_size);
 
-    shift_left(m_input_samples, m_input_samples.size() - dup_size);
+    m_window -= distance;
+    if (m_cut_start) *m_cut_start -= distance * m_chunk_size;
 
     return m_output_samples;
 }
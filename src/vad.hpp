@@ -10,40 +10,64 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <optional>
+#include <ostream>
+#include <string>
 #include <vector>
 
-struct WebRtcVadInst;
-
 class vad {
    public:
     using buf_t = std::vector<int16_t>;
 
+    enum class backend_type_t { webrtc, silero };
+    friend std::ostream& operator<<(std::ostream& os, backend_type_t type);
+
+    struct config_t {
+        backend_type_t backend_type = backend_type_t::webrtc;
+        int webrtc_mode = 3;    /* aggressiveness 0-3 */
+        std::string model_file; /* used only with silero */
+        float threshold = 0.5F; /* used only with silero */
+    };
+
+    // classifies fixed size chunks of 16 kHz audio
+    class backend {
+       public:
+        virtual ~backend() = default;
+        virtual size_t chunk_size() const = 0;
+        virtual void restart() = 0;
+        virtual bool is_speech_chunk(const buf_t::value_type* chunk) = 0;
+    };
+
     struct voice_active_result {
         std::optional<size_t> start;
         std::optional<size_t> stop;
     };
 
     vad();
+    explicit vad(config_t config);
     ~vad();
     void reset();
     void restart();
     const buf_t& remove_silence(const buf_t::value_type* frame, size_t frame_size);
     bool is_speech(const buf_t::value_type* frame, size_t frame_size);
+    inline auto backend_type() const { return m_config.backend_type; }
 
    private:
-    inline static const size_t m_chunk_size = 480;
-    inline static const size_t m_dup_max_size = 10 * m_chunk_size;
     inline static const size_t m_chunks_in_frame = 25;
 
-    WebRtcVadInst* m_handle = nullptr;
-    int m_mode = 3;
-    int m_fs = 16000;
+    config_t m_config;
+    std::unique_ptr<backend> m_backend;
+    size_t m_chunk_size = 0;
     buf_t m_input_samples;
     buf_t m_output_samples;
-    size_t m_dup_size = 0;
+    std::vector<size_t> m_speech_chunks_acc;  // prefix sums of vad results
+    size_t m_window = 0;                      // first chunk of next window
+    std::optional<size_t> m_cut_start;
 
-    std::vector<bool> vad_process(const buf_t& samples) const;
+    void create_backend();
+    void vad_process();
+    void trim_input(size_t distance);
     static void shift_left(std::vector<int16_t>& vec, size_t distance);
 };
 
@@ -21,7 +21,6 @@
 #include <sstream>
 
 #include "logger.hpp"
-#include "nlohmann/json.hpp"
 
 using namespace std::chrono_literals;
 
@@ -170,6 +169,9 @@ void vosk_engine::restart_recognizer(bool force) {
     }
 
     m_vosk_api.vosk_recognizer_set_words(m_vosk_recognizer, 1);
+
+    m_partial_interval = m_partial_min_interval;
+    m_last_partial_time.reset();
 }
 
 void vosk_engine::create_model() {
@@ -245,7 +247,7 @@ stt_engine::samples_process_result_t vosk_engine::process_buff() {
         m_in_buf.size * sizeof(decltype(m_in_buf.buf)::value_type));
 #endif
 
-    m_denoiser.process(m_in_buf.buf.data(), m_in_buf.size);
+    denoise_in_buf();
 
 #ifdef DUMP_AUDIO_TO_FILE
     if (!m_file_audio_after_denoise)
@@ -256,8 +258,7 @@ stt_engine::samples_process_result_t vosk_engine::process_buff() {
         m_in_buf.size * sizeof(decltype(m_in_buf.buf)::value_type));
 #endif
 
-    const auto& vad_buf =
-        m_vad.remove_silence(m_in_buf.buf.data(), m_in_buf.size);
+    const auto& vad_buf = remove_silence_from_in_buf();
 
 #ifdef DUMP_AUDIO_TO_FILE
     if (!m_file_audio_after_vad)
@@ -352,83 +353,131 @@ stt_engine::samples_process_result_t vosk_engine::process_buff() {
     return samples_process_result_t::wait_for_samples;
 }
 
-static std::string from_json(const char* name, const char* str) {
-    std::string text;
-
-    try {
-        text.assign(nlohmann::json::parse(str)[name]);
-    } catch (const nlohmann::json::parse_error& err) {
-        LOGE("json parse error: " << err.what() << ", id=" << err.id
-                                  << ", pos=" << err.byte << ", doc=" << str);
-    }
-
-    return text;
+simdjson::padded_string_view vosk_engine::padded_json(const char* str) {
+    // reuse one buffer instead of allocating padded copy for every result
+    m_json_buf.assign(str);
+    m_json_buf.reserve(m_json_buf.size() + simdjson::SIMDJSON_PADDING);
+    return simdjson::padded_string_view{m_json_buf, m_json_buf.capacity()};
 }
 
-static std::string partial_text_from_json(const char* str) {
-    return from_json("partial", str);
-}
+std::string vosk_engine::text_from_json(std::string_view key,
+                                        const char* str) {
+    std::string_view text;
+
+    auto doc = m_json_parser.iterate(padded_json(str));
+    if (auto err = doc[key].get(text)) {
+        LOGE("json parse error: " << err << ", doc=" << str);
+        return {};
+    }
 
-static std::string text_from_json(const char* str) {
-    return from_json("text", str);
+    return std::string{text};
 }
 
 std::pair<std::string, std::vector<text_tools::segment_t>>
 vosk_engine::segments_from_json(const char* str) {
     std::pair<std::string, std::vector<text_tools::segment_t>> result;
 
+    const size_t max_dur = m_config.sub_config.min_segment_dur == 0
+                               ? 60000
+                               : m_config.sub_config.min_segment_dur * 1000;
+    std::optional<size_t> t0;
+    size_t t1 = 0;
+    std::string segment_text;
+
     try {
-        auto doc = nlohmann::json::parse(str);
-        result.first = doc["text"];
-
-        const size_t max_dur = m_config.sub_config.min_segment_dur == 0
-                                   ? 60000
-                                   : m_config.sub_config.min_segment_dur * 1000;
-        std::optional<size_t> t0;
-        std::string segment_text;
-
-        if (doc["result"].is_array()) {
-            const auto& arr = doc["result"];
-            for (auto it = arr.cbegin(); it != arr.cend(); ++it) {
-                std::string text = it.value()["word"];
-                if (text.empty()) continue;
+        auto doc = m_json_parser.iterate(padded_json(str));
+
+        // fields are visited in document order, so the doc is parsed once
+        for (auto field : doc.get_object()) {
+            std::string_view key = field.unescaped_key();
+
+            if (key == "text") {
+                result.first = std::string_view{field.value()};
+                continue;
+            }
+
+            if (key != "result") continue;
+
+            for (auto word : field.value().get_array()) {
+                std::string_view text;
+                double start = 0;
+                double end = 0;
+
+                for (auto word_field : word.get_object()) {
+                    std::string_view word_key = word_field.unescaped_key();
+                    if (word_key == "word")
+                        text = word_field.value();
+                    else if (word_key == "start")
+                        start = word_field.value();
+                    else if (word_key == "end")
+                        end = word_field.value();
+                }
 
-                float start = it.value()["start"];
-                float end = it.value()["end"];
+                if (text.empty()) continue;
 
-                segment_text.append(std::move(text));
+                if (!segment_text.empty()) segment_text.push_back(' ');
+                segment_text.append(text);
 
-                if (t0) {
-                    size_t t1 = end * 1000 + m_segment_time_offset;
+                t1 = end * 1000 + m_segment_time_offset;
 
-                    if (t1 - *t0 > max_dur || it == std::prev(arr.cend())) {
-                        result.second.push_back({++m_segment_offset, *t0, t1,
-                                                 std::move(segment_text)});
-                        segment_text.clear();
-                        t0.reset();
-                    } else {
-                        segment_text.push_back(' ');
-                    }
-                } else {
-                    segment_text.push_back(' ');
+                if (!t0) {
                     t0 = start * 1000 + m_segment_time_offset;
+                } else if (t1 - *t0 > max_dur) {
+                    result.second.push_back(
+                        {++m_segment_offset, *t0, t1, std::move(segment_text)});
+                    segment_text.clear();
+                    t0.reset();
                 }
             }
         }
-    } catch (const nlohmann::json::parse_error& err) {
-        LOGE("json parse error: " << err.what() << ", id=" << err.id
-                                  << ", pos=" << err.byte << ", doc=" << str);
+    } catch (const simdjson::simdjson_error& err) {
+        LOGE("json parse error: " << err.what() << ", doc=" << str);
     }
 
+    if (t0)
+        result.second.push_back(
+            {++m_segment_offset, *t0, t1, std::move(segment_text)});
+
     return result;
 }
 
+bool vosk_engine::partial_result_throttled() const {
+    // first partial result is never delayed
+    if (!m_last_partial_time || !m_intermediate_text ||
+        m_intermediate_text->empty())
+        return false;
+
+    return std::chrono::steady_clock::now() - *m_last_partial_time <
+           m_partial_interval;
+}
+
+void vosk_engine::update_partial_interval(
+    std::chrono::steady_clock::time_point request_start, bool text_changed) {
+    auto now = std::chrono::steady_clock::now();
+
+    // back off while text is stable, catch up quickly when it changes
+    m_partial_interval = text_changed ? m_partial_interval / 2
+                                      : m_partial_interval * 2;
+    m_partial_interval =
+        std::max(m_partial_interval,
+                 m_partial_cost_factor * (now - request_start));
+    m_partial_interval =
+        std::clamp<std::chrono::steady_clock::duration>(
+            m_partial_interval, m_partial_min_interval, m_partial_max_interval);
+
+    m_last_partial_time = now;
+}
+
 void vosk_engine::decode_speech(const vosk_buf_t& buf, bool eof) {
     LOGD("speech decoding started");
 
+    auto decoding_start = std::chrono::steady_clock::now();
+
     auto ret = m_vosk_api.vosk_recognizer_accept_waveform_s(
         m_vosk_recognizer, buf.data(), buf.size());
 
+    record_stage(stage_t::inference, decoding_start);
+
     if (ret < 0) {
         LOGE("error in vosk_recognizer_accept_waveform_s");
         return;
@@ -437,6 +486,13 @@ void vosk_engine::decode_speech(const vosk_buf_t& buf, bool eof) {
     if (ret == 0 && !eof) {
         if (m_config.text_format == text_format_t::subrip) {
             return;
+        } else if (partial_result_throttled()) {
+            LOGD("partial result throttled: interval="
+                 << std::chrono::duration_cast<std::chrono::milliseconds>(
+                        m_partial_interval)
+                        .count()
+                 << "ms");
+            return;
         } else {
             // append silence to force partial result
             std::array<vosk_buf_t::value_type, m_in_buf_max_size> silence{};
@@ -457,7 +513,7 @@ void vosk_engine::decode_speech(const vosk_buf_t& buf, bool eof) {
             m_vosk_api.vosk_recognizer_final_result(m_vosk_recognizer));
 
         if (m_punctuator) {
-            segments.first = m_punctuator->process(segments.first);
+            segments.first = punctuate(segments.first);
             text_tools::restore_punctuation_in_segments(segments.first,
                                                         segments.second);
         }
@@ -470,12 +526,14 @@ void vosk_engine::decode_speech(const vosk_buf_t& buf, bool eof) {
             text_tools::segments_to_subrip_text(segments.second),
             m_config.lang);
     } else {
+        auto request_start = std::chrono::steady_clock::now();
+
         auto result =
-            eof ? text_from_json(m_vosk_api.vosk_recognizer_final_result(
-                      m_vosk_recognizer))
-                : partial_text_from_json(
-                      m_vosk_api.vosk_recognizer_partial_result(
-                          m_vosk_recognizer));
+            eof ? text_from_json("text", m_vosk_api.vosk_recognizer_final_result(
+                                             m_vosk_recognizer))
+                : text_from_json("partial",
+                                 m_vosk_api.vosk_recognizer_partial_result(
+                                     m_vosk_recognizer));
 
 #ifdef DEBUG
         LOGD("speech decoded: text=" << result);
@@ -483,10 +541,17 @@ void vosk_engine::decode_speech(const vosk_buf_t& buf, bool eof) {
         LOGD("speech decoded");
 #endif
 
-        if (m_punctuator) result = m_punctuator->process(result);
+        if (m_punctuator) result = punctuate(result);
+
+        bool text_changed =
+            !m_intermediate_text || m_intermediate_text != result;
+
+        if (eof)
+            m_last_partial_time.reset();
+        else
+            update_partial_interval(request_start, text_changed);
 
-        if (!m_intermediate_text || m_intermediate_text != result)
-            set_intermediate_text(result, m_config.lang);
+        if (text_changed) set_intermediate_text(result, m_config.lang);
     }
 
     setlocale(LC_NUMERIC, old_locale);
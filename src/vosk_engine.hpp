@@ -8,9 +8,11 @@
 #ifndef VOSK_ENGINE_H
 #define VOSK_ENGINE_H
 
+#include <chrono>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #ifdef DUMP_AUDIO_TO_FILE
@@ -18,6 +20,7 @@
 #include <memory>
 #endif
 
+#include "simdjson.h"
 #include "stt_engine.hpp"
 #include "text_tools.hpp"
 
@@ -60,12 +63,23 @@ class vosk_engine : public stt_engine {
     };
 
     inline static const size_t m_speech_max_size = m_sample_rate * 60;  // 60s
+    // bounds of adaptive interval between partial result requests
+    inline static const auto m_partial_min_interval = 250ms;
+    inline static const auto m_partial_max_interval = 2s;
+    // interval is kept at least this many times longer than partial result
+    // request took
+    inline static const int m_partial_cost_factor = 10;
 
     vosk_buf_t m_speech_buf;
     vosk_api m_vosk_api;
     void* m_lib_handle = nullptr;
     VoskModel* m_vosk_model = nullptr;
     VoskRecognizer* m_vosk_recognizer = nullptr;
+    simdjson::ondemand::parser m_json_parser;
+    std::string m_json_buf;
+    std::chrono::steady_clock::duration m_partial_interval =
+        m_partial_min_interval;
+    std::optional<std::chrono::steady_clock::time_point> m_last_partial_time;
 
 #ifdef DUMP_AUDIO_TO_FILE
     std::unique_ptr<std::ofstream> m_file_audio_input;
@@ -81,6 +95,12 @@ class vosk_engine : public stt_engine {
     void reset_impl() override;
     void start_processing_impl() override;
     void push_inbuf_to_samples();
+    bool partial_result_throttled() const;
+    void update_partial_interval(
+        std::chrono::steady_clock::time_point request_start,
+        bool text_changed);
+    simdjson::padded_string_view padded_json(const char* str);
+    std::string text_from_json(std::string_view key, const char* str);
     std::pair<std::string, std::vector<text_tools::segment_t>>
     segments_from_json(const char* str);
 };
@@ -10,17 +10,24 @@
 #include <dirent.h>
 #include <dlfcn.h>
 #include <fmt/format.h>
+#include <fcntl.h>
 #include <fmt/ranges.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 #include <string>
 
+#include "audio_tools.hpp"
 #include "cpu_tools.hpp"
 #include "logger.hpp"
 #include "text_tools.hpp"
@@ -29,7 +36,9 @@ whisper_engine::whisper_engine(config_t config, callbacks_t call_backs)
     : stt_engine{std::move(config), std::move(call_backs)} {
     open_whisper_lib();
     m_wparams = make_wparams();
-    m_speech_buf.reserve(m_speech_max_size);
+    m_speech_buf.reserve(m_speech_max_size + m_in_buf_max_size);
+    // smaller input blocks for more frequent partial results
+    if (m_config.streaming) m_in_buf_publish_size = m_stream_step;
 }
 
 whisper_engine::~whisper_engine() {
@@ -37,8 +46,18 @@ whisper_engine::~whisper_engine() {
 
     stop();
 
+    stop_offline_workers();
+
     if (m_whisper_api.ok()) {
-        if (m_whisper_ctx) {
+        if (m_whisper_state) {
+            m_whisper_api.whisper_free_state(m_whisper_state);
+            m_whisper_state = nullptr;
+        }
+        if (m_whisper_model) {
+            // shared model is freed when last engine releases it
+            m_whisper_model.reset();
+            m_whisper_ctx = nullptr;
+        } else if (m_whisper_ctx) {
             m_whisper_api.whisper_free(m_whisper_ctx);
             m_whisper_ctx = nullptr;
         }
@@ -82,8 +101,9 @@ bool whisper_engine::available() {
     available = try_open_lib("libwhisper-openblas.so");
 #else
     auto cpuinfo = cpu_tools::cpuinfo();
-    if (cpuinfo.feature_flags & cpu_tools::feature_flags_t::avx2) {
-        available = try_open_lib("libwhisper-openblas.so");
+    for (const auto& variant : cpu_lib_variants()) {
+        available = try_open_lib(("libwhisper-" + variant + ".so").c_str());
+        if (available) break;
     }
     if (!available &&
         (cpuinfo.feature_flags & cpu_tools::feature_flags_t::avx)) {
@@ -190,6 +210,29 @@ bool whisper_engine::has_vulkan() {
     return try_open_lib("libwhisper-vulkan.so");
 }
 
+std::vector<std::string> whisper_engine::cpu_lib_variants() {
+    std::vector<std::string> variants;
+#ifdef ARCH_X86_64
+    auto flags = cpu_tools::cpuinfo().feature_flags;
+    if ((flags & cpu_tools::feature_flags_t::avx) == 0 ||
+        (flags & cpu_tools::feature_flags_t::f16c) == 0 ||
+        (flags & cpu_tools::feature_flags_t::avx2) == 0)
+        return variants;
+
+    // most capable first, libs without blas use ggml native kernels
+    if (flags & cpu_tools::feature_flags_t::avx512 &&
+        flags & cpu_tools::feature_flags_t::avx512bw &&
+        flags & cpu_tools::feature_flags_t::avx512dq &&
+        flags & cpu_tools::feature_flags_t::avx512_vnni)
+        variants.emplace_back("avx512");
+    if (flags & cpu_tools::feature_flags_t::avx_vnni)
+        variants.emplace_back("avxvnni");
+    variants.emplace_back("openblas");
+    variants.emplace_back("noblas");
+#endif
+    return variants;
+}
+
 bool whisper_engine::use_openvino() const {
 #ifdef ARCH_X86_64
     auto cpuinfo = cpu_tools::cpuinfo();
@@ -293,14 +336,28 @@ void whisper_engine::open_whisper_lib() {
         }
 
         if (m_whisperlib_handle == nullptr) {
-            if (cpuinfo.feature_flags & cpu_tools::feature_flags_t::avx2) {
-                LOGD("using whisper-openblas (avx2)");
-                m_whisperlib_handle =
-                    dlopen("libwhisper-openblas.so", RTLD_LAZY);
-                if (m_whisperlib_handle == nullptr)
-                    LOGE(
-                        "failed to open libwhisper-openblas.so: " << dlerror());
-            } else {
+            auto variants = cpu_lib_variants();
+            if (!m_config.cpu_lib_variant.empty()) {
+                // variant measured as the fastest goes first
+                auto it = std::find(variants.begin(), variants.end(),
+                                    m_config.cpu_lib_variant);
+                if (it != variants.end())
+                    std::rotate(variants.begin(), it, std::next(it));
+            }
+
+            for (const auto& variant : variants) {
+                auto lib = "libwhisper-" + variant + ".so";
+                m_whisperlib_handle = dlopen(lib.c_str(), RTLD_LAZY);
+                if (m_whisperlib_handle != nullptr) {
+                    LOGD("using whisper-" << variant);
+                    m_loaded_cpu_lib_variant = variant;
+                    break;
+                }
+                // optional variant, may be not shipped
+                LOGD("failed to open " << lib << ": " << dlerror());
+            }
+
+            if (m_whisperlib_handle == nullptr) {
                 LOGD("using whisper-fallback1 (avx)");
                 m_whisperlib_handle =
                     dlopen("libwhisper-fallback1.so", RTLD_LAZY);
@@ -329,6 +386,17 @@ void whisper_engine::open_whisper_lib() {
     m_whisper_api.whisper_init_from_file_with_params = reinterpret_cast<
         decltype(m_whisper_api.whisper_init_from_file_with_params)>(
         dlsym(m_whisperlib_handle, "whisper_init_from_file_with_params"));
+    m_whisper_api.whisper_init_from_file_with_params_no_state =
+        reinterpret_cast<decltype(
+            m_whisper_api.whisper_init_from_file_with_params_no_state)>(
+            dlsym(m_whisperlib_handle,
+                  "whisper_init_from_file_with_params_no_state"));
+    m_whisper_api.whisper_init_with_params =
+        reinterpret_cast<decltype(m_whisper_api.whisper_init_with_params)>(
+            dlsym(m_whisperlib_handle, "whisper_init_with_params"));
+    m_whisper_api.whisper_init_with_params_no_state = reinterpret_cast<
+        decltype(m_whisper_api.whisper_init_with_params_no_state)>(
+        dlsym(m_whisperlib_handle, "whisper_init_with_params_no_state"));
     m_whisper_api.whisper_print_system_info =
         reinterpret_cast<decltype(m_whisper_api.whisper_print_system_info)>(
             dlsym(m_whisperlib_handle, "whisper_print_system_info"));
@@ -365,6 +433,39 @@ void whisper_engine::open_whisper_lib() {
     m_whisper_api.whisper_lang_str =
         reinterpret_cast<decltype(m_whisper_api.whisper_lang_str)>(
             dlsym(m_whisperlib_handle, "whisper_lang_str"));
+    m_whisper_api.whisper_init_state =
+        reinterpret_cast<decltype(m_whisper_api.whisper_init_state)>(
+            dlsym(m_whisperlib_handle, "whisper_init_state"));
+    m_whisper_api.whisper_free_state =
+        reinterpret_cast<decltype(m_whisper_api.whisper_free_state)>(
+            dlsym(m_whisperlib_handle, "whisper_free_state"));
+    m_whisper_api.whisper_full_with_state =
+        reinterpret_cast<decltype(m_whisper_api.whisper_full_with_state)>(
+            dlsym(m_whisperlib_handle, "whisper_full_with_state"));
+    m_whisper_api.whisper_full_n_segments_from_state = reinterpret_cast<
+        decltype(m_whisper_api.whisper_full_n_segments_from_state)>(
+        dlsym(m_whisperlib_handle, "whisper_full_n_segments_from_state"));
+    m_whisper_api.whisper_full_get_segment_text_from_state = reinterpret_cast<
+        decltype(m_whisper_api.whisper_full_get_segment_text_from_state)>(
+        dlsym(m_whisperlib_handle, "whisper_full_get_segment_text_from_state"));
+    m_whisper_api.whisper_full_get_segment_t0_from_state = reinterpret_cast<
+        decltype(m_whisper_api.whisper_full_get_segment_t0_from_state)>(
+        dlsym(m_whisperlib_handle, "whisper_full_get_segment_t0_from_state"));
+    m_whisper_api.whisper_full_get_segment_t1_from_state = reinterpret_cast<
+        decltype(m_whisper_api.whisper_full_get_segment_t1_from_state)>(
+        dlsym(m_whisperlib_handle, "whisper_full_get_segment_t1_from_state"));
+    m_whisper_api.whisper_full_lang_id_from_state = reinterpret_cast<
+        decltype(m_whisper_api.whisper_full_lang_id_from_state)>(
+        dlsym(m_whisperlib_handle, "whisper_full_lang_id_from_state"));
+    m_whisper_api.whisper_pcm_to_mel =
+        reinterpret_cast<decltype(m_whisper_api.whisper_pcm_to_mel)>(
+            dlsym(m_whisperlib_handle, "whisper_pcm_to_mel"));
+    m_whisper_api.whisper_lang_auto_detect =
+        reinterpret_cast<decltype(m_whisper_api.whisper_lang_auto_detect)>(
+            dlsym(m_whisperlib_handle, "whisper_lang_auto_detect"));
+    m_whisper_api.whisper_lang_max_id =
+        reinterpret_cast<decltype(m_whisper_api.whisper_lang_max_id)>(
+            dlsym(m_whisperlib_handle, "whisper_lang_max_id"));
 
     if (!m_whisper_api.ok()) {
         LOGE("failed to register whisper api");
@@ -375,26 +476,23 @@ void whisper_engine::open_whisper_lib() {
 void whisper_engine::push_buf_to_whisper_buf(
     const std::vector<in_buf_t::buf_t::value_type>& buf,
     whisper_buf_t& whisper_buf) {
-    // convert s16 to f32 sample format
-    std::transform(buf.cbegin(), buf.cend(), std::back_inserter(whisper_buf),
-                   [](auto sample) {
-                       return static_cast<whisper_buf_t::value_type>(sample) /
-                              32768.0F;
-                   });
+    audio_tools::append_s16_as_f32(buf.data(), buf.size(), whisper_buf);
 }
 
-void whisper_engine::push_buf_to_whisper_buf(in_buf_t::buf_t::value_type* data,
-                                             in_buf_t::buf_t::size_type size,
-                                             whisper_buf_t& whisper_buf) {
-    // convert s16 to f32 sample format
-    whisper_buf.reserve(whisper_buf.size() + size);
-    for (size_t i = 0; i < size; ++i) {
-        whisper_buf.push_back(static_cast<whisper_buf_t::value_type>(data[i]) /
-                              32768.0F);
-    }
+void whisper_engine::push_buf_to_whisper_buf(
+    in_buf_t::buf_t::value_type* data, in_buf_t::buf_t::size_type size,
+    whisper_buf_t& whisper_buf) {
+    audio_tools::append_s16_as_f32(data, size, whisper_buf);
 }
 
-void whisper_engine::reset_impl() { m_speech_buf.clear(); }
+void whisper_engine::reset_impl() {
+    m_speech_buf.clear();
+    clear_offline_jobs();
+    // decoder states of workers take a lot of memory
+    stop_offline_workers();
+    reset_stream();
+    reset_sup_lang();
+}
 
 void whisper_engine::stop_processing_impl() {
     if (m_whisper_ctx) {
@@ -422,6 +520,94 @@ static std::string first_file_with_ext(std::string dir_path,
     return {};
 }
 
+namespace {
+// read-only mapping of model file used as whisper model loader
+struct mmap_model_file {
+    void* addr = MAP_FAILED;
+    size_t size = 0;
+    size_t pos = 0;
+
+    explicit mmap_model_file(const std::string& file) {
+        auto fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+
+        struct stat st {};
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            size = static_cast<size_t>(st.st_size);
+            addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+
+        ::close(fd);  // mapping stays valid
+
+        if (addr != MAP_FAILED) {
+            // model is read once from start to end
+            madvise(addr, size, MADV_SEQUENTIAL);
+            madvise(addr, size, MADV_WILLNEED);
+        }
+    }
+
+    ~mmap_model_file() { unmap(); }
+
+    inline bool ok() const { return addr != MAP_FAILED; }
+
+    void unmap() {
+        if (addr != MAP_FAILED) {
+            munmap(addr, size);
+            addr = MAP_FAILED;
+        }
+    }
+
+    static size_t read(void* ctx, void* output, size_t read_size) {
+        auto* file = static_cast<mmap_model_file*>(ctx);
+        if (!file->ok()) return 0;
+
+        read_size = std::min(read_size, file->size - file->pos);
+        std::memcpy(output, static_cast<const char*>(file->addr) + file->pos,
+                    read_size);
+        file->pos += read_size;
+
+        return read_size;
+    }
+
+    static bool eof(void* ctx) {
+        auto* file = static_cast<mmap_model_file*>(ctx);
+        return file->pos >= file->size;
+    }
+
+    static void close(void* ctx) {
+        static_cast<mmap_model_file*>(ctx)->unmap();
+    }
+};
+}  // namespace
+
+void* whisper_engine::init_model_from_file(const std::string& model_file,
+                                           const whisper_context_params& params,
+                                           bool no_state) {
+    auto* init_with_loader =
+        no_state ? m_whisper_api.whisper_init_with_params_no_state
+                 : m_whisper_api.whisper_init_with_params;
+
+    if (init_with_loader) {
+        mmap_model_file file{model_file};
+        if (file.ok()) {
+            LOGD("loading whisper model with mmap: " << model_file);
+
+            whisper_model_loader loader{&file, &mmap_model_file::read,
+                                        &mmap_model_file::eof,
+                                        &mmap_model_file::close};
+
+            return init_with_loader(&loader, params);
+        }
+
+        LOGW("failed to mmap whisper model: " << model_file);
+    }
+
+    return no_state ? m_whisper_api.whisper_init_from_file_with_params_no_state(
+                          model_file.c_str(), params)
+                    : m_whisper_api.whisper_init_from_file_with_params(
+                          model_file.c_str(), params);
+}
+
 void whisper_engine::create_model() {
     if (m_whisper_ctx) return;
 
@@ -432,15 +618,27 @@ void whisper_engine::create_model() {
     params.gpu_device = m_config.gpu_device.id;
     params.flash_attn = m_config.gpu_device.flash_attn;
 
-    m_whisper_ctx = m_whisper_api.whisper_init_from_file_with_params(
-        m_config.model_files.model_file.c_str(), params);
+    if (use_shared_model()) {
+        m_whisper_model = acquire_shared_model(params);
+        m_whisper_ctx = m_whisper_model.get();
+    } else {
+        m_whisper_ctx = init_model_from_file(m_config.model_files.model_file,
+                                             params, /*no_state=*/false);
+    }
 
     if (m_whisper_ctx == nullptr) {
         LOGE("failed to create whisper model");
         throw std::runtime_error("failed to create whisper model");
     }
 
-    if (use_openvino()) {
+    if (m_whisper_model) {
+        // decoder state of this engine, model is shared
+        m_whisper_state = m_whisper_api.whisper_init_state(m_whisper_ctx);
+        if (m_whisper_state == nullptr) {
+            LOGE("failed to create whisper state");
+            throw std::runtime_error("failed to create whisper state");
+        }
+    } else if (use_openvino()) {
         auto idx = m_config.model_files.model_file.rfind('/');
         auto ov_file = first_file_with_ext(
             m_config.model_files.openvino_model_file, "xml");
@@ -464,8 +662,8 @@ void whisper_engine::create_model() {
 
     if (!m_whisper_sup_ctx && !m_config.model_files.scorer_file.empty()) {
         // sup model
-        m_whisper_sup_ctx = m_whisper_api.whisper_init_from_file_with_params(
-            m_config.model_files.scorer_file.c_str(), params);
+        m_whisper_sup_ctx = init_model_from_file(
+            m_config.model_files.scorer_file, params, /*no_state=*/false);
 
         if (m_whisper_sup_ctx == nullptr) {
             LOGW("failed to create sup whisper model");
@@ -475,7 +673,55 @@ void whisper_engine::create_model() {
     LOGD("whisper model created");
 }
 
+bool whisper_engine::use_shared_model() const {
+    // openvino encoder is initialized in context's default state
+    return m_whisper_api.state_ok() &&
+           m_whisper_api.whisper_init_from_file_with_params_no_state &&
+           !use_openvino();
+}
+
+std::shared_ptr<void> whisper_engine::acquire_shared_model(
+    const whisper_context_params& params) {
+    shared_model_key_t key{m_config.model_files.model_file, m_whisperlib_handle,
+                           params.use_gpu, params.gpu_device,
+                           params.flash_attn};
+
+    std::lock_guard lock{m_shared_models_mtx};
+
+    if (auto it = m_shared_models.find(key); it != m_shared_models.end()) {
+        if (auto model = it->second.lock()) {
+            LOGD("using shared whisper model: " << key.model_file);
+            return model;
+        }
+    }
+
+    for (auto it = m_shared_models.begin(); it != m_shared_models.end();) {
+        if (it->second.expired())
+            it = m_shared_models.erase(it);
+        else
+            ++it;
+    }
+
+    auto* ctx = init_model_from_file(key.model_file, params,
+                                     /*no_state=*/true);
+    if (ctx == nullptr) return {};
+
+    std::shared_ptr<void> model{
+        ctx, [whisper_free = m_whisper_api.whisper_free](void* ctx) {
+            LOGD("freeing shared whisper model");
+            whisper_free(ctx);
+        }};
+
+    m_shared_models.emplace(std::move(key), model);
+
+    LOGD("shared whisper models: " << m_shared_models.size());
+
+    return model;
+}
+
 stt_engine::samples_process_result_t whisper_engine::process_buff() {
+    emit_offline_jobs(false);
+
     if (!lock_buff_for_processing())
         return samples_process_result_t::wait_for_samples;
 
@@ -492,12 +738,14 @@ stt_engine::samples_process_result_t whisper_engine::process_buff() {
         m_start_time.reset();
         m_vad.reset();
         reset_segment_counters();
+        clear_offline_jobs();
+        reset_stream();
+        reset_sup_lang();
     }
 
-    m_denoiser.process(m_in_buf.buf.data(), m_in_buf.size);
+    denoise_in_buf();
 
-    const auto& vad_buf =
-        m_vad.remove_silence(m_in_buf.buf.data(), m_in_buf.size);
+    const auto& vad_buf = remove_silence_from_in_buf();
 
     bool vad_status = !vad_buf.empty();
 
@@ -565,11 +813,18 @@ stt_engine::samples_process_result_t whisper_engine::process_buff() {
         if (eof || (m_config.speech_mode == speech_mode_t::manual &&
                     m_speech_detection_status ==
                         speech_detection_status_t::no_speech)) {
+            if (eof) {
+                emit_offline_jobs(true);
+                stop_offline_workers();
+            }
             flush(eof ? flush_t::eof : flush_t::regular);
             free_buf();
             return samples_process_result_t::no_samples_needed;
         }
 
+        if (vad_status && use_streaming() && !m_thread_exit_requested)
+            stream_decode();
+
         free_buf();
         return samples_process_result_t::wait_for_samples;
     }
@@ -590,10 +845,36 @@ stt_engine::samples_process_result_t whisper_engine::process_buff() {
     m_segment_time_offset += m_segment_time_discarded_before;
     m_segment_time_discarded_before = 0;
 
-    decode_speech(m_speech_buf);
+    auto speech_time = 1000 * m_speech_buf.size() / m_sample_rate;
+
+    if (use_offline_workers()) {
+        push_offline_job(std::move(m_speech_buf), m_segment_time_offset);
+
+        m_speech_buf = whisper_buf_t{};
+        m_speech_buf.reserve(m_speech_max_size + m_in_buf_max_size);
+
+        m_segment_time_offset += m_segment_time_discarded_after + speech_time;
+        m_segment_time_discarded_after = 0;
+
+        if (eof) {
+            emit_offline_jobs(true);
+            stop_offline_workers();
+            flush(flush_t::eof);
+        }
+
+        set_state(state_t::idle);
+
+        free_buf();
+
+        return samples_process_result_t::wait_for_samples;
+    }
+
+    if (m_stream_active)
+        stream_decode_final();
+    else
+        decode_speech(m_speech_buf);
 
-    m_segment_time_offset += (m_segment_time_discarded_after +
-                              (1000 * m_speech_buf.size() / m_sample_rate));
+    m_segment_time_offset += m_segment_time_discarded_after + speech_time;
     m_segment_time_discarded_after = 0;
 
     set_state(state_t::idle);
@@ -627,6 +908,143 @@ static bool abort_callback(void* user_data) {
     return is_aborted;
 }
 
+namespace {
+// splits whisper_full time into encoder and decoder parts
+struct inference_timer_t {
+    const bool* exit_requested = nullptr;
+    std::chrono::steady_clock::time_point encoder_start;
+    std::chrono::steady_clock::time_point decoder_start;
+    std::chrono::steady_clock::duration encoder_duration{};
+    std::chrono::steady_clock::duration decoder_duration{};
+    std::atomic_bool encoding = false;
+    bool decoding = false;
+
+    void finish() {
+        auto now = std::chrono::steady_clock::now();
+        if (encoding.exchange(false)) encoder_duration += now - encoder_start;
+        if (decoding) decoder_duration += now - decoder_start;
+        decoding = false;
+    }
+};
+}  // namespace
+
+static bool timed_encoder_begin_callback([[maybe_unused]] void* ctx,
+                                         [[maybe_unused]] void* state,
+                                         void* user_data) {
+    auto* timer = static_cast<inference_timer_t*>(user_data);
+
+    // whisper_full encodes each 30 s window before decoding it
+    timer->finish();
+    timer->encoder_start = std::chrono::steady_clock::now();
+    timer->encoding = true;
+
+    return !*timer->exit_requested;
+}
+
+// called by each decoder (possibly in parallel), first call ends encoding
+static void logits_filter_callback(
+    [[maybe_unused]] void* ctx, [[maybe_unused]] void* state,
+    [[maybe_unused]] const whisper_token_data* tokens,
+    [[maybe_unused]] int n_tokens, [[maybe_unused]] float* logits,
+    void* user_data) {
+    auto* timer = static_cast<inference_timer_t*>(user_data);
+
+    if (!timer->encoding.exchange(false)) return;
+
+    auto now = std::chrono::steady_clock::now();
+    timer->encoder_duration += now - timer->encoder_start;
+    timer->decoder_start = now;
+    timer->decoding = true;
+}
+
+// short audio clips optimization
+// https://github.com/ggerganov/whisper.cpp/issues/1855
+static int dynamic_audio_ctx(size_t nb_samples, size_t sample_rate) {
+    return std::min<int>(((1500 * nb_samples) / (sample_rate * 30)) + 128,
+                         1500);
+}
+
+std::optional<whisper_engine::tuning_t> whisper_engine::calibrate(
+    const std::vector<int16_t>& clip, double max_wer) {
+    if (clip.empty()) return std::nullopt;
+
+    create_model();
+
+    whisper_buf_t buf;
+    push_buf_to_whisper_buf(clip, buf);
+
+    auto clip_ms = static_cast<double>(clip.size()) * 1000 / m_sample_rate;
+
+    std::string ref_text;
+
+    auto run = [&](tuning_t& tuning) {
+        auto wparams = m_wparams;
+        wparams.n_threads = static_cast<int>(tuning.cpu_threads);
+        wparams.beam_search = {static_cast<int>(tuning.beam_search), 0.0};
+        wparams.audio_ctx =
+            tuning.audio_ctx_conf == audio_ctx_conf_t::dynamic
+                ? dynamic_audio_ctx(buf.size(), m_sample_rate)
+                : 1500;
+        if (!m_config.initial_prompt.empty())
+            wparams.initial_prompt = m_config.initial_prompt.c_str();
+
+        auto decoded = decode(m_whisper_state, buf, wparams);
+        if (!decoded.ok) return false;
+
+        std::string text;
+        for (const auto& segment : decoded.segments) {
+            if (!text.empty()) text.push_back(' ');
+            text.append(segment.text);
+        }
+
+        if (ref_text.empty()) ref_text = text;
+
+        tuning.rtf = decoded.processing_duration_ms / clip_ms;
+        tuning.wer = text_tools::word_error_rate(ref_text, text);
+
+        LOGD("calibration: threads=" << tuning.cpu_threads << ", audio_ctx="
+                                     << tuning.audio_ctx_conf
+                                     << ", beam_search=" << tuning.beam_search
+                                     << ", rtf=" << tuning.rtf
+                                     << ", wer=" << tuning.wer);
+
+        return !m_thread_exit_requested;
+    };
+
+    auto max_threads = std::max(1U, std::thread::hardware_concurrency());
+
+    // reference decoding, also warms up the model
+    tuning_t best{max_threads, audio_ctx_conf_t::no_change, 5};
+    if (!run(best)) return std::nullopt;
+
+    // threads don't change result, so they are tuned first
+    for (auto threads = 1U; threads < max_threads; threads *= 2) {
+        tuning_t tuning{threads, best.audio_ctx_conf, best.beam_search};
+        if (!run(tuning)) return std::nullopt;
+        if (tuning.rtf < best.rtf) best = tuning;
+    }
+
+    for (auto audio_ctx_conf :
+         {audio_ctx_conf_t::dynamic, audio_ctx_conf_t::no_change}) {
+        for (auto beam_search : {1U, 2U, 5U}) {
+            if (audio_ctx_conf == audio_ctx_conf_t::no_change &&
+                beam_search == 5U)
+                continue;  // already measured
+
+            tuning_t tuning{best.cpu_threads, audio_ctx_conf, beam_search};
+            if (!run(tuning)) return std::nullopt;
+            if (tuning.wer <= max_wer && tuning.rtf < best.rtf) best = tuning;
+        }
+    }
+
+    LOGD("calibration best: threads="
+         << best.cpu_threads << ", audio_ctx=" << best.audio_ctx_conf
+         << ", beam_search=" << best.beam_search << ", rtf=" << best.rtf
+         << ", wer=" << best.wer);
+
+    return best;
+}
+
 whisper_full_params whisper_engine::make_wparams() {
     whisper_full_params wparams =
         m_whisper_api.whisper_full_default_params(WHISPER_SAMPLING_BEAM_SEARCH);
@@ -680,126 +1098,172 @@ whisper_full_params whisper_engine::make_wparams() {
     return wparams;
 }
 
-void whisper_engine::decode_speech(const whisper_buf_t& buf) {
-    LOGD("speech decoding started");
-
-    create_model();
-
-    auto decoding_start = std::chrono::steady_clock::now();
+whisper_full_params whisper_engine::make_decode_wparams(
+    const whisper_buf_t& buf) {
+    auto wparams = m_wparams;
 
-    bool subrip = m_config.text_format == text_format_t::subrip;
+    if (m_thread_lease.threads() > 0) {
+        wparams.n_threads = std::min(
+            wparams.n_threads, static_cast<int>(m_thread_lease.threads()));
+    }
 
     if (m_config.audio_ctx_conf == audio_ctx_conf_t::dynamic &&
         !use_openvino() && !use_gpu()) {
-        // short audio clips optimization
-        // https://github.com/ggerganov/whisper.cpp/issues/1855
-        m_wparams.audio_ctx = std::min<int>(
-            ((1500 * buf.size()) / (m_sample_rate * 30)) + 128, 1500);
+        wparams.audio_ctx = dynamic_audio_ctx(buf.size(), m_sample_rate);
     }
 
-    LOGD("audio_ctx: " << m_wparams.audio_ctx);
+    LOGD("audio_ctx: " << wparams.audio_ctx);
+
+    if (m_whisper_sup_ctx && wparams.language == nullptr) {
+        // use sup model to detect language only when session language is
+        // not known yet, is uncertain or should be re-checked
+        if (!m_sup_lang || m_sup_lang_prob < m_sup_lang_min_prob ||
+            m_sup_lang_segments >= m_sup_lang_recheck_interval)
+            detect_lang_with_sup(buf, wparams);
+        else
+            ++m_sup_lang_segments;
 
-    bool auto_lang = m_wparams.language == nullptr;
+        if (m_sup_lang) wparams.language = m_sup_lang;
+    }
 
-    if (m_whisper_sup_ctx && auto_lang) {
-        // use sup model to detect language
-        m_wparams.detect_language = true;
-        m_wparams.initial_prompt = nullptr;
+    if (!m_config.initial_prompt.empty()) {
+        wparams.initial_prompt = m_config.initial_prompt.c_str();
+    }
 
-        if (auto ret = m_whisper_api.whisper_full(m_whisper_sup_ctx, m_wparams,
-                                                  buf.data(), buf.size());
+    return wparams;
+}
+
+void whisper_engine::reset_sup_lang() {
+    m_sup_lang = nullptr;
+    m_sup_lang_prob = 0.0F;
+    m_sup_lang_segments = 0;
+}
+
+void whisper_engine::detect_lang_with_sup(const whisper_buf_t& buf,
+                                          const whisper_full_params& wparams) {
+    int lang_number = -1;
+    float prob = 0.0F;
+
+    if (m_whisper_api.lang_detect_ok()) {
+        // encoder pass on mel of buf prefix, no decoding
+        auto size =
+            static_cast<int>(std::min(buf.size(), m_sup_lang_max_size));
+        if (auto ret = m_whisper_api.whisper_pcm_to_mel(
+                m_whisper_sup_ctx, buf.data(), size, wparams.n_threads);
             ret == 0) {
-            auto lang_number =
-                m_whisper_api.whisper_full_lang_id(m_whisper_sup_ctx);
-            if (lang_number >= 0) {
-                const auto* lang_id =
-                    m_whisper_api.whisper_lang_str(lang_number);
-                LOGD("auto lang with sup: " << lang_id);
-                m_wparams.language = lang_id;
-            } else {
-                LOGW("auto lang not detected with sup");
-            }
+            std::vector<float> probs(m_whisper_api.whisper_lang_max_id() + 1);
+            lang_number = m_whisper_api.whisper_lang_auto_detect(
+                m_whisper_sup_ctx, 0, wparams.n_threads, probs.data());
+            if (lang_number >= 0) prob = probs[lang_number];
+        } else {
+            LOGE("whisper error sup mel: " << ret);
+        }
+    } else {
+        // older lib, full decoding without probabilities
+        auto sup_wparams = wparams;
+        sup_wparams.detect_language = true;
+        sup_wparams.initial_prompt = nullptr;
+        sup_wparams.new_segment_callback = nullptr;
+
+        if (auto ret = m_whisper_api.whisper_full(
+                m_whisper_sup_ctx, sup_wparams, buf.data(), buf.size());
+            ret == 0) {
+            lang_number = m_whisper_api.whisper_full_lang_id(m_whisper_sup_ctx);
+            prob = 1.0F;
         } else {
-            LOGE("whisper error sup" << ret);
+            LOGE("whisper error sup: " << ret);
         }
+    }
+
+    m_sup_lang_segments = 0;
 
-        m_wparams.detect_language = false;
+    if (lang_number < 0) {
+        LOGW("auto lang not detected with sup");
+        return;
     }
 
-    std::ostringstream os;
+    const auto* lang_id = m_whisper_api.whisper_lang_str(lang_number);
 
-    if (!m_config.initial_prompt.empty()) {
-        m_wparams.initial_prompt = m_config.initial_prompt.c_str();
-    }
-
-    if (auto ret = m_whisper_api.whisper_full(m_whisper_ctx, m_wparams,
-                                              buf.data(), buf.size());
-        ret == 0) {
-        auto n = m_whisper_api.whisper_full_n_segments(m_whisper_ctx);
-        LOGD("decoded segments: " << n);
-
-        bool add_spc = false;
-        int seg_n = 0;
-        for (auto i = 0; i < n; ++i) {
-            std::string text =
-                m_whisper_api.whisper_full_get_segment_text(m_whisper_ctx, i);
-            if (text.empty()) continue;
-            if (text.at(0) == '!') text.erase(0, 1);
-            rtrim(text);
-            ltrim(text);
-            if (text.empty()) continue;
+    LOGD("auto lang with sup: " << lang_id << " (" << prob << ")");
+
+    // less certain result doesn't override more certain one
+    if (!m_sup_lang || prob >= m_sup_lang_min_prob || prob > m_sup_lang_prob) {
+        m_sup_lang = lang_id;
+        m_sup_lang_prob = prob;
+    }
+}
+
+std::optional<whisper_engine::decoded_segment_t> whisper_engine::get_segment(
+    void* state, int i) {
+    std::string text =
+        state
+            ? m_whisper_api.whisper_full_get_segment_text_from_state(state, i)
+            : m_whisper_api.whisper_full_get_segment_text(m_whisper_ctx, i);
+    if (text.empty()) return std::nullopt;
+    if (text.at(0) == '!') text.erase(0, 1);
+    rtrim(text);
+    ltrim(text);
+    if (text.empty()) return std::nullopt;
 #ifdef DEBUG
-            LOGD("segment " << i << ": " << text);
+    LOGD("segment " << i << ": " << text);
 #endif
-            if (subrip) {
-                size_t t0 = std::max<int64_t>(
-                                0, m_whisper_api.whisper_full_get_segment_t0(
-                                       m_whisper_ctx, i)) *
-                            10;
-                size_t t1 = std::max<int64_t>(
-                                0, m_whisper_api.whisper_full_get_segment_t1(
-                                       m_whisper_ctx, i)) *
-                            10;
-
-                t0 += m_segment_time_offset;
-                t1 += m_segment_time_offset;
-
-                text_tools::segment_t segment{i + 1 + m_segment_offset, t0, t1,
-                                              text};
-                text_tools::break_segment_to_multiline(
-                    m_config.sub_config.min_line_length,
-                    m_config.sub_config.max_line_length, segment);
-
-                text_tools::segment_to_subrip_text(segment, os);
-            } else {
-                if (add_spc) os << ' ';
-                os << text;
-                add_spc = true;
-            }
+    auto t0 =
+        state ? m_whisper_api.whisper_full_get_segment_t0_from_state(state, i)
+              : m_whisper_api.whisper_full_get_segment_t0(m_whisper_ctx, i);
+    auto t1 =
+        state ? m_whisper_api.whisper_full_get_segment_t1_from_state(state, i)
+              : m_whisper_api.whisper_full_get_segment_t1(m_whisper_ctx, i);
+
+    return decoded_segment_t{
+        std::move(text), static_cast<size_t>(std::max<int64_t>(0, t0)) * 10,
+        static_cast<size_t>(std::max<int64_t>(0, t1)) * 10};
+}
 
-            ++seg_n;
-        }
+whisper_engine::decoded_t whisper_engine::decode(
+    void* state, const whisper_buf_t& buf, const whisper_full_params& wparams) {
+    decoded_t decoded;
+    decoded.nb_samples = buf.size();
 
-        m_segment_offset += seg_n;
-    } else {
+    inference_timer_t timer;
+    timer.exit_requested = &m_thread_exit_requested;
+
+    auto timed_wparams = wparams;
+    timed_wparams.encoder_begin_callback = timed_encoder_begin_callback;
+    timed_wparams.encoder_begin_callback_user_data = &timer;
+    timed_wparams.logits_filter_callback = logits_filter_callback;
+    timed_wparams.logits_filter_callback_user_data = &timer;
+
+    auto decoding_start = std::chrono::steady_clock::now();
+
+    // state == nullptr => default state of not shared context
+    auto ret = state ? m_whisper_api.whisper_full_with_state(
+                           m_whisper_ctx, state, timed_wparams, buf.data(),
+                           static_cast<int>(buf.size()))
+                     : m_whisper_api.whisper_full(m_whisper_ctx, timed_wparams,
+                                                  buf.data(), buf.size());
+    record_stage(stage_t::inference, decoding_start);
+    timer.finish();
+    record_stage(stage_t::encoder, timer.encoder_duration);
+    record_stage(stage_t::decoder, timer.decoder_duration);
+    if (ret != 0) {
         LOGE("whisper error: " << ret);
-        return;
+        return decoded;
     }
 
-    if (m_thread_exit_requested) return;
+    auto n = state ? m_whisper_api.whisper_full_n_segments_from_state(state)
+                   : m_whisper_api.whisper_full_n_segments(m_whisper_ctx);
+    LOGD("decoded segments: " << n);
 
-    auto stats = report_stats(
-        buf.size(), m_sample_rate,
-        static_cast<size_t>(std::max(
-            0L, static_cast<long int>(
-                    std::chrono::duration_cast<std::chrono::milliseconds>(
-                        std::chrono::steady_clock::now() - decoding_start)
-                        .count()))));
+    for (auto i = 0; i < n; ++i) {
+        if (auto segment = get_segment(state, i))
+            decoded.segments.push_back(std::move(*segment));
+    }
 
-    auto auto_lang_id = [&]() -> std::string {
-        if (!m_wparams.language) {  // auto-detected lang
+    decoded.lang = [&]() -> std::string {
+        if (!wparams.language) {  // auto-detected lang
             auto lang_number =
-                m_whisper_api.whisper_full_lang_id(m_whisper_ctx);
+                state ? m_whisper_api.whisper_full_lang_id_from_state(state)
+                      : m_whisper_api.whisper_full_lang_id(m_whisper_ctx);
             if (lang_number < 0) {
                 LOGW("auto lang not detected");
                 return m_config.lang;
@@ -810,21 +1274,522 @@ void whisper_engine::decode_speech(const whisper_buf_t& buf) {
 
             return lang_id;
         } else {
-            return m_wparams.language;
+            return wparams.language;
         }
     }();
 
-    if (auto_lang) m_wparams.language = nullptr;
+    decoded.processing_duration_ms = static_cast<size_t>(
+        std::max(0L, static_cast<long int>(
+                         std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - decoding_start)
+                             .count())));
+    decoded.ok = true;
+
+    return decoded;
+}
 
-    auto result =
-        merge_texts(m_intermediate_text.value_or(std::string{}), os.str());
+std::string whisper_engine::segments_to_text(
+    const std::vector<decoded_segment_t>& segments, size_t time_offset) const {
+    bool subrip = m_config.text_format == text_format_t::subrip;
 
-    if (m_config.insert_stats && !result.empty()) result.append(" " + stats);
+    std::ostringstream os;
+
+    bool add_spc = false;
+    unsigned int seg_n = 0;
+    for (const auto& decoded_segment : segments) {
+        if (subrip) {
+            text_tools::segment_t segment{seg_n + 1 + m_segment_offset,
+                                          decoded_segment.t0 + time_offset,
+                                          decoded_segment.t1 + time_offset,
+                                          decoded_segment.text};
+            text_tools::break_segment_to_multiline(
+                m_config.sub_config.min_line_length,
+                m_config.sub_config.max_line_length, segment);
+
+            text_tools::segment_to_subrip_text(segment, os);
+        } else {
+            if (add_spc) os << ' ';
+            os << decoded_segment.text;
+            add_spc = true;
+        }
+
+        ++seg_n;
+    }
+
+    return os.str();
+}
+
+void whisper_engine::emit_decoded(const decoded_t& decoded,
+                                  size_t time_offset) {
+    if (!decoded.ok || m_thread_exit_requested) return;
+
+    auto text = segments_to_text(decoded.segments, time_offset);
+
+    m_segment_offset += decoded.segments.size();
+
+    auto stats = report_stats(decoded.nb_samples, m_sample_rate,
+                              decoded.processing_duration_ms);
 
 #ifdef DEBUG
-    LOGD("speech decoded: text=" << result);
+    LOGD("speech decoded: text=" << text);
 #endif
 
+    if (!m_config.insert_stats) {
+        merge_intermediate_text(std::move(text), decoded.lang);
+        return;
+    }
+
+    auto result = merge_texts(m_intermediate_text.value_or(std::string{}),
+                              std::move(text));
+
+    if (!result.empty()) result.append(" " + stats);
+
     if (!m_intermediate_text || m_intermediate_text != result)
-        set_intermediate_text(result, auto_lang_id);
+        set_intermediate_text(result, decoded.lang);
+}
+
+void whisper_engine::decode_speech(const whisper_buf_t& buf) {
+    LOGD("speech decoding started");
+
+    create_model();
+
+    auto wparams = make_decode_wparams(buf);
+
+    // show segments as soon as whisper produces them, reading segments in
+    // callback needs state api
+    m_progressive_segments.clear();
+    m_progressive_base_text = m_intermediate_text.value_or(std::string{});
+    m_progressive_time_offset = m_segment_time_offset;
+    if (m_whisper_api.state_ok()) {
+        wparams.new_segment_callback = new_segment_callback;
+        wparams.new_segment_callback_user_data = this;
+    }
+
+    auto decoded = decode(m_whisper_state, buf, wparams);
+
+    if (!m_progressive_segments.empty()) {
+        // partial text is replaced by the final one
+        if (m_progressive_base_text.empty())
+            m_intermediate_text.reset();
+        else
+            m_intermediate_text = m_progressive_base_text;
+        m_progressive_segments.clear();
+    }
+
+    emit_decoded(decoded, m_segment_time_offset);
+}
+
+void whisper_engine::new_segment_callback([[maybe_unused]] void* ctx,
+                                          void* state, int n_new,
+                                          void* user_data) {
+    static_cast<whisper_engine*>(user_data)->emit_new_segments(state, n_new);
+}
+
+void whisper_engine::emit_new_segments(void* state, int n_new) {
+    if (m_thread_exit_requested) return;
+
+    auto n = m_whisper_api.whisper_full_n_segments_from_state(state);
+    for (auto i = std::max(0, n - n_new); i < n; ++i) {
+        if (auto segment = get_segment(state, i))
+            m_progressive_segments.push_back(std::move(*segment));
+    }
+
+    auto lang = [&]() -> std::string {
+        auto lang_number = m_whisper_api.whisper_full_lang_id_from_state(state);
+        if (lang_number < 0) return m_config.lang;
+        return m_whisper_api.whisper_lang_str(lang_number);
+    }();
+
+    set_intermediate_text(
+        merge_texts(m_progressive_base_text,
+                    segments_to_text(m_progressive_segments,
+                                     m_progressive_time_offset)),
+        lang);
+}
+
+static std::vector<std::string> split_words(const std::string& text) {
+    std::vector<std::string> words;
+
+    std::istringstream is{text};
+    for (std::string word; is >> word;) words.push_back(std::move(word));
+
+    return words;
+}
+
+static std::string join_words(std::vector<std::string>::const_iterator beg,
+                              std::vector<std::string>::const_iterator end) {
+    std::string text;
+
+    for (auto it = beg; it != end; ++it) {
+        if (!text.empty()) text.push_back(' ');
+        text.append(*it);
+    }
+
+    return text;
+}
+
+bool whisper_engine::use_streaming() const {
+    return m_config.streaming && !m_config.offline &&
+           m_config.text_format == text_format_t::raw &&
+           !use_offline_workers();
+}
+
+void whisper_engine::reset_stream() {
+    m_stream_active = false;
+    m_stream_window_start = 0;
+    m_stream_last_pass_size = 0;
+    m_stream_step_size = m_stream_step;
+    m_stream_window_committed = 0;
+    m_stream_committed.clear();
+    m_stream_prev_hyp.clear();
+    m_stream_base_text.clear();
+}
+
+whisper_engine::decoded_t whisper_engine::decode_stream_window() {
+    m_stream_window_buf.assign(m_speech_buf.cbegin() + m_stream_window_start,
+                               m_speech_buf.cend());
+
+    auto wparams = make_decode_wparams(m_stream_window_buf);
+
+    // words committed before the window give context for its audio
+    auto committed_end = m_stream_committed.cend() - m_stream_window_committed;
+    if (m_stream_committed.cbegin() != committed_end) {
+        auto committed =
+            join_words(m_stream_committed.cbegin(), committed_end);
+        if (committed.size() > m_stream_prompt_max_size)
+            committed.erase(0, committed.size() - m_stream_prompt_max_size);
+
+        m_stream_prompt = m_config.initial_prompt;
+        if (!m_stream_prompt.empty()) m_stream_prompt.push_back(' ');
+        m_stream_prompt.append(committed);
+
+        wparams.initial_prompt = m_stream_prompt.c_str();
+    }
+
+    wparams.no_context = true;
+
+    return decode(m_whisper_state, m_stream_window_buf, wparams);
+}
+
+void whisper_engine::stream_decode() {
+    if (m_speech_buf.size() < m_stream_last_pass_size + m_stream_step_size ||
+        m_speech_buf.size() < m_stream_window_start + m_stream_min_window)
+        return;
+
+    create_model();
+
+    if (!m_stream_active) {
+        m_stream_active = true;
+        m_stream_base_text = m_intermediate_text.value_or(std::string{});
+    }
+
+    m_stream_last_pass_size = m_speech_buf.size();
+
+    auto decoded = decode_stream_window();
+    if (!decoded.ok || m_thread_exit_requested) return;
+
+    // don't start next pass before previous one would have finished
+    m_stream_step_size =
+        std::max(m_stream_step,
+                 decoded.processing_duration_ms * m_sample_rate / 1000);
+
+    std::vector<std::string> hyp;
+    std::vector<size_t> segment_words;
+    for (const auto& segment : decoded.segments) {
+        auto words = split_words(segment.text);
+        segment_words.push_back(words.size());
+        std::move(words.begin(), words.end(), std::back_inserter(hyp));
+    }
+
+    // words committed in this window must be prefix of new hypothesis,
+    // words that whisper changed its mind about are taken back
+    size_t anchored = 0;
+    auto window_committed =
+        m_stream_committed.cend() - m_stream_window_committed;
+    while (anchored < m_stream_window_committed && anchored < hyp.size() &&
+           hyp[anchored] == window_committed[anchored])
+        ++anchored;
+    if (anchored < m_stream_window_committed) {
+        LOGD("stream committed words taken back: "
+             << m_stream_window_committed - anchored);
+        m_stream_committed.resize(m_stream_committed.size() -
+                                  (m_stream_window_committed - anchored));
+        m_stream_window_committed = anchored;
+    }
+
+    // local agreement: prefix shared with previous hypothesis is stable
+    size_t agreed = 0;
+    while (agreed < hyp.size() && agreed < m_stream_prev_hyp.size() &&
+           hyp[agreed] == m_stream_prev_hyp[agreed])
+        ++agreed;
+
+    bool force = m_speech_buf.size() - m_stream_window_start >
+                 m_stream_max_window;
+    if (force) {
+        // window too long, commit all but last segment
+        agreed = hyp.size() - (segment_words.size() > 1 ? segment_words.back()
+                                                         : 0);
+    }
+
+    if (agreed > m_stream_window_committed) {
+        m_stream_committed.insert(m_stream_committed.end(),
+                                  hyp.cbegin() + m_stream_window_committed,
+                                  hyp.cbegin() + agreed);
+        m_stream_window_committed = agreed;
+    }
+
+    // drop audio of fully committed segments to bound the recompute
+    size_t words = 0;
+    size_t trim_words = 0;
+    auto trim_pos = m_stream_window_start;
+    for (size_t i = 0; i < decoded.segments.size(); ++i) {
+        words += segment_words[i];
+        if (words > m_stream_window_committed) break;
+
+        bool last = i + 1 == decoded.segments.size();
+        if (last && !force) break;
+
+        trim_words = words;
+        trim_pos = last ? m_speech_buf.size()
+                        : m_stream_window_start +
+                              decoded.segments[i].t1 * m_sample_rate / 1000;
+    }
+
+    if (trim_words > 0) {
+        hyp.erase(hyp.begin(), hyp.begin() + trim_words);
+        m_stream_window_committed -= trim_words;
+        m_stream_window_start = std::min(trim_pos, m_speech_buf.size());
+    }
+
+    m_stream_prev_hyp = hyp;
+
+    LOGD("stream pass: committed words=" << m_stream_committed.size()
+                                         << ", window start="
+                                         << m_stream_window_start
+                                         << ", step=" << m_stream_step_size);
+
+    auto text = join_words(m_stream_committed.cbegin(),
+                           m_stream_committed.cend());
+    auto tentative = join_words(
+        hyp.cbegin() + std::min(m_stream_window_committed, hyp.size()),
+        hyp.cend());
+    if (!text.empty() && !tentative.empty()) text.push_back(' ');
+    text.append(tentative);
+
+    set_intermediate_text(merge_texts(m_stream_base_text, std::move(text)),
+                          decoded.lang);
+}
+
+void whisper_engine::stream_decode_final() {
+    LOGD("stream final decoding started");
+
+    decoded_t decoded;
+    if (m_speech_buf.size() > m_stream_window_start)
+        decoded = decode_stream_window();
+
+    // words committed in the window are decoded again with the window
+    auto committed_end =
+        decoded.ok ? m_stream_committed.cend() - m_stream_window_committed
+                   : m_stream_committed.cend();
+
+    if (!decoded.ok) {
+        decoded.segments.clear();
+        decoded.lang = m_intermediate_lang;
+        decoded.ok = true;
+    }
+
+    if (m_stream_committed.cbegin() != committed_end) {
+        decoded.segments.insert(
+            decoded.segments.begin(),
+            {join_words(m_stream_committed.cbegin(), committed_end), 0, 0});
+    }
+
+    decoded.nb_samples = m_speech_buf.size();
+
+    // partial text is replaced by the final one
+    if (m_stream_base_text.empty())
+        m_intermediate_text.reset();
+    else
+        m_intermediate_text = m_stream_base_text;
+
+    emit_decoded(decoded, m_segment_time_offset);
+
+    reset_stream();
+}
+
+bool whisper_engine::use_offline_workers() const {
+    return m_config.offline && m_whisper_api.state_ok() && !use_gpu() &&
+           !use_openvino() && m_config.speech_mode == speech_mode_t::automatic;
+}
+
+void whisper_engine::start_offline_workers() {
+    if (!m_offline_workers.empty()) return;
+
+    // first worker uses cores of processing thread, others take free cores
+    // from the thread budget, each worker holds own whisper state
+    auto worker_threads =
+        static_cast<unsigned int>(std::max(1, m_wparams.n_threads));
+    if (m_thread_lease.threads() > 0)
+        worker_threads = std::min(worker_threads, m_thread_lease.threads());
+
+    auto max_workers = std::min<size_t>(
+        m_offline_max_workers,
+        std::max(1U, m_config.cpu_threads / worker_threads));
+
+    std::vector<cpu_tools::thread_lease> leases;
+    leases.emplace_back();
+    if (!m_thread_lease.shared()) {
+        while (leases.size() < max_workers) {
+            auto lease = cpu_tools::acquire_threads(worker_threads);
+            if (lease.shared()) break;
+            leases.push_back(std::move(lease));
+        }
+    }
+
+    LOGD("starting offline workers: " << leases.size()
+                                      << ", threads per worker="
+                                      << worker_threads);
+
+    m_offline_shutdown = false;
+
+    for (auto& lease : leases)
+        m_offline_workers.emplace_back(&whisper_engine::offline_worker_loop,
+                                       this, std::move(lease));
+}
+
+void whisper_engine::stop_offline_workers() {
+    if (m_offline_workers.empty()) return;
+
+    LOGD("stopping offline workers");
+
+    {
+        std::lock_guard lock{m_offline_mtx};
+        m_offline_shutdown = true;
+    }
+
+    m_offline_cv.notify_all();
+
+    for (auto& worker : m_offline_workers)
+        if (worker.joinable()) worker.join();
+
+    m_offline_workers.clear();
+
+    for (auto& job : m_offline_queue) job->promise.set_value({});
+    m_offline_queue.clear();
+}
+
+void whisper_engine::offline_worker_loop(cpu_tools::thread_lease lease) {
+    // thread inherits affinity of processing thread, which is right only for
+    // the first worker that runs on processing thread's cores
+    lease.pin_current_thread();
+
+    // each worker has its own decoder state, model is shared
+    auto* state = m_whisper_api.whisper_init_state(m_whisper_ctx);
+    if (state == nullptr) LOGE("failed to create whisper state");
+
+    while (true) {
+        std::unique_lock lock{m_offline_mtx};
+        m_offline_cv.wait(lock, [this] {
+            return m_offline_shutdown || !m_offline_queue.empty();
+        });
+
+        if (m_offline_shutdown) break;
+
+        auto job = std::move(m_offline_queue.front());
+        m_offline_queue.pop_front();
+
+        lock.unlock();
+
+        // processing thread may wait for free space in queue
+        m_offline_cv.notify_all();
+
+        record_stage(stage_t::queue, job->queued_time);
+
+        if (state && !m_thread_exit_requested) {
+            LOGD("offline job decoding: samples=" << job->buf.size()
+                                                  << ", time-offset="
+                                                  << job->time_offset);
+            if (lease.threads() > 0)
+                job->wparams.n_threads = std::min(
+                    job->wparams.n_threads, static_cast<int>(lease.threads()));
+            job->promise.set_value(decode(state, job->buf, job->wparams));
+        } else {
+            job->promise.set_value({});
+        }
+
+        // only result is needed from now on
+        whisper_buf_t{}.swap(job->buf);
+
+        notify_processing();
+    }
+
+    if (state) m_whisper_api.whisper_free_state(state);
+}
+
+void whisper_engine::push_offline_job(whisper_buf_t&& buf, size_t time_offset) {
+    create_model();
+    start_offline_workers();
+
+    auto job = std::make_shared<offline_job_t>();
+    job->wparams = make_decode_wparams(buf);
+    // segments are decoded out of order, so past text can't be a prompt
+    job->wparams.no_context = true;
+    job->buf = std::move(buf);
+    job->time_offset = time_offset;
+    job->queued_time = std::chrono::steady_clock::now();
+
+    m_offline_jobs.push_back(job);
+
+    {
+        // backpressure, so long file doesn't end up in memory as queued jobs
+        std::unique_lock lock{m_offline_mtx};
+        m_offline_cv.wait(lock, [this] {
+            return m_offline_shutdown ||
+                   m_offline_queue.size() < m_offline_workers.size() *
+                                                m_offline_queue_size_per_worker;
+        });
+        m_offline_queue.push_back(std::move(job));
+    }
+
+    m_offline_cv.notify_all();
+}
+
+void whisper_engine::emit_offline_jobs(bool wait) {
+    while (!m_offline_jobs.empty()) {
+        auto& job = m_offline_jobs.front();
+
+        if (!wait && job->result.wait_for(0s) != std::future_status::ready)
+            break;
+
+        if (wait) set_state(state_t::decoding);
+
+        auto decoded = job->result.get();
+        auto time_offset = job->time_offset;
+
+        m_offline_jobs.pop_front();
+
+        // jobs are emitted in order, so segment numbers stay correct
+        emit_decoded(decoded, time_offset);
+
+        flush(flush_t::regular);
+    }
+
+    if (wait) set_state(state_t::idle);
+}
+
+void whisper_engine::clear_offline_jobs() {
+    if (m_offline_jobs.empty()) return;
+
+    LOGD("clearing offline jobs: " << m_offline_jobs.size());
+
+    {
+        std::lock_guard lock{m_offline_mtx};
+        for (auto& job : m_offline_queue) job->promise.set_value({});
+        m_offline_queue.clear();
+    }
+
+    // wait for jobs in progress
+    for (auto& job : m_offline_jobs) job->result.wait();
+
+    m_offline_jobs.clear();
 }
@@ -8,6 +8,16 @@
 #ifndef WHISPER_ENGINE_H
 #define WHISPER_ENGINE_H
 
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
 #include <vector>
 
 #include "stt_engine.hpp"
@@ -148,6 +158,13 @@ typedef void (*whisper_progress_callback)(void* ctx, void* state, int progress,
 typedef bool (*whisper_encoder_begin_callback)(void* ctx, void* state,
                                                void* user_data);
 
+// Logits filter callback
+// Can be used to modify the logits before sampling
+// If not NULL, called after applying temperature to logits
+typedef void (*whisper_logits_filter_callback)(
+    void* ctx, void* state, const whisper_token_data* tokens, int n_tokens,
+    float* logits, void* user_data);
+
 // Abort callback
 // If not NULL, called before ggml computation
 // If it returns true, the computation is aborted
@@ -267,7 +284,7 @@ struct whisper_full_params {
     void* abort_callback_user_data;
 
     // called by each decoder to filter obtained logits
-    void* logits_filter_callback;
+    whisper_logits_filter_callback logits_filter_callback;
     void* logits_filter_callback_user_data;
 
     const whisper_grammar_element** grammar_rules;
@@ -287,10 +304,26 @@ class whisper_engine : public stt_engine {
     static bool has_openvino();
     static bool has_opencl();
     static bool has_vulkan();
+    // cpu lib variants supported by this cpu in default preference order
+    static std::vector<std::string> cpu_lib_variants();
+
+    struct tuning_t {
+        unsigned int cpu_threads = 0;
+        audio_ctx_conf_t audio_ctx_conf = audio_ctx_conf_t::dynamic;
+        unsigned int beam_search = 0;
+        double rtf = 0.0;  // processing time / audio time
+        double wer = 0.0;  // against decoding with most accurate params
+    };
 
     whisper_engine(config_t config, callbacks_t call_backs);
     ~whisper_engine() override;
 
+    // decodes clip with different threads, audio_ctx and beam search params
+    // and returns the fastest one with wer not higher than max_wer
+    std::optional<tuning_t> calibrate(const std::vector<int16_t>& clip,
+                                      double max_wer);
+    auto loaded_cpu_lib_variant() const { return m_loaded_cpu_lib_variant; }
+
    private:
     using whisper_buf_t = std::vector<float>;
 
@@ -299,6 +332,14 @@ class whisper_engine : public stt_engine {
     struct whisper_api {
         void* (*whisper_init_from_file_with_params)(
             const char* path_model, whisper_context_params params) = nullptr;
+        void* (*whisper_init_from_file_with_params_no_state)(
+            const char* path_model, whisper_context_params params) = nullptr;
+        void* (*whisper_init_with_params)(
+            whisper_model_loader* loader,
+            whisper_context_params params) = nullptr;
+        void* (*whisper_init_with_params_no_state)(
+            whisper_model_loader* loader,
+            whisper_context_params params) = nullptr;
         const char* (*whisper_print_system_info)() = nullptr;
         int (*whisper_full)(void* ctx, whisper_full_params params,
                             const float* samples, int n_samples) = nullptr;
@@ -318,6 +359,26 @@ class whisper_engine : public stt_engine {
             const char* cache_dir) = nullptr;
         int (*whisper_full_lang_id)(void* ctx) = nullptr;
         const char* (*whisper_lang_str)(int id) = nullptr;
+        void* (*whisper_init_state)(void* ctx) = nullptr;
+        void (*whisper_free_state)(void* state) = nullptr;
+        int (*whisper_full_with_state)(void* ctx, void* state,
+                                       whisper_full_params params,
+                                       const float* samples,
+                                       int n_samples) = nullptr;
+        int (*whisper_full_n_segments_from_state)(void* state) = nullptr;
+        const char* (*whisper_full_get_segment_text_from_state)(
+            void* state, int i_segment) = nullptr;
+        int64_t (*whisper_full_get_segment_t0_from_state)(
+            void* state, int i_segment) = nullptr;
+        int64_t (*whisper_full_get_segment_t1_from_state)(
+            void* state, int i_segment) = nullptr;
+        int (*whisper_full_lang_id_from_state)(void* state) = nullptr;
+        int (*whisper_pcm_to_mel)(void* ctx, const float* samples,
+                                  int n_samples, int n_threads) = nullptr;
+        int (*whisper_lang_auto_detect)(void* ctx, int offset_ms,
+                                        int n_threads,
+                                        float* lang_probs) = nullptr;
+        int (*whisper_lang_max_id)() = nullptr;
         inline auto ok() const {
             return whisper_init_from_file_with_params &&
                    whisper_print_system_info && whisper_full &&
@@ -328,19 +389,153 @@ class whisper_engine : public stt_engine {
                    whisper_ctx_init_openvino_encoder && whisper_full_lang_id &&
                    whisper_lang_str;
         }
+        inline auto state_ok() const {
+            return whisper_init_state && whisper_free_state &&
+                   whisper_full_with_state &&
+                   whisper_full_n_segments_from_state &&
+                   whisper_full_get_segment_text_from_state &&
+                   whisper_full_get_segment_t0_from_state &&
+                   whisper_full_get_segment_t1_from_state &&
+                   whisper_full_lang_id_from_state;
+        }
+        inline auto lang_detect_ok() const {
+            return whisper_pcm_to_mel && whisper_lang_auto_detect &&
+                   whisper_lang_max_id;
+        }
+    };
+
+    struct decoded_segment_t {
+        std::string text;
+        size_t t0 = 0;  // ms
+        size_t t1 = 0;  // ms
+    };
+
+    struct decoded_t {
+        bool ok = false;
+        std::vector<decoded_segment_t> segments;
+        std::string lang;
+        size_t nb_samples = 0;
+        size_t processing_duration_ms = 0;
+    };
+
+    // speech segment decoded in background by one of offline workers
+    struct offline_job_t {
+        whisper_buf_t buf;
+        whisper_full_params wparams{};
+        size_t time_offset = 0;
+        std::chrono::steady_clock::time_point queued_time;
+        std::promise<decoded_t> promise;
+        std::future<decoded_t> result = promise.get_future();
+    };
+
+    // processing thread waits when queue is this deep per worker
+    inline static const size_t m_offline_queue_size_per_worker = 2;
+    // upper limit of offline workers, each one allocates whisper state
+    inline static const size_t m_offline_max_workers = 4;
+    inline static const size_t m_stream_step = m_sample_rate / 2;  // 0.5s
+    inline static const size_t m_stream_min_window =
+        m_sample_rate / 2;  // 0.5s
+    inline static const size_t m_stream_max_window =
+        m_sample_rate * 10;  // 10s
+    inline static const size_t m_stream_prompt_max_size = 200;
+    inline static const size_t m_sup_lang_max_size =
+        m_sample_rate * 30;  // 30s
+    inline static const float m_sup_lang_min_prob = 0.8F;
+    inline static const unsigned int m_sup_lang_recheck_interval = 20;
+
+    // key of model loaded once and shared by all whisper engines
+    struct shared_model_key_t {
+        std::string model_file;
+        void* lib_handle = nullptr;
+        bool use_gpu = false;
+        int gpu_device = -1;
+        bool flash_attn = false;
+
+        bool operator<(const shared_model_key_t& rhs) const {
+            return std::tie(model_file, lib_handle, use_gpu, gpu_device,
+                            flash_attn) <
+                   std::tie(rhs.model_file, rhs.lib_handle, rhs.use_gpu,
+                            rhs.gpu_device, rhs.flash_attn);
+        }
     };
 
+    inline static std::mutex m_shared_models_mtx;
+    inline static std::map<shared_model_key_t, std::weak_ptr<void>>
+        m_shared_models;
+
     whisper_buf_t m_speech_buf;
     whisper_api m_whisper_api;
     void* m_whisperlib_handle = nullptr;
+    std::string m_loaded_cpu_lib_variant;
     void* m_whisper_ctx = nullptr;
+    void* m_whisper_state = nullptr;
+    std::shared_ptr<void> m_whisper_model;  // set when model is shared
     void* m_whisper_sup_ctx = nullptr;
+    // language detected with sup model, reused for the rest of session
+    const char* m_sup_lang = nullptr;
+    float m_sup_lang_prob = 0.0F;
+    unsigned int m_sup_lang_segments = 0;  // decoded since last detection
     whisper_full_params m_wparams{};
+    std::vector<std::thread> m_offline_workers;
+    std::deque<std::shared_ptr<offline_job_t>> m_offline_queue;
+    std::deque<std::shared_ptr<offline_job_t>> m_offline_jobs;
+    std::mutex m_offline_mtx;
+    std::condition_variable m_offline_cv;
+    bool m_offline_shutdown = false;
+
+    // streaming with local agreement of two consecutive hypotheses
+    bool m_stream_active = false;
+    size_t m_stream_window_start = 0;     // first not committed sample
+    size_t m_stream_last_pass_size = 0;   // speech buf size in last pass
+    size_t m_stream_step_size = m_stream_step;
+    size_t m_stream_window_committed = 0;  // committed words of window
+    std::vector<std::string> m_stream_committed;
+    std::vector<std::string> m_stream_prev_hyp;
+    std::string m_stream_base_text;
+    std::string m_stream_prompt;
+    whisper_buf_t m_stream_window_buf;
+
+    // segments emitted while whisper_full is still running
+    std::vector<decoded_segment_t> m_progressive_segments;
+    std::string m_progressive_base_text;
+    size_t m_progressive_time_offset = 0;
 
     void open_whisper_lib();
     void create_model();
+    bool use_shared_model() const;
+    void* init_model_from_file(const std::string& model_file,
+                               const whisper_context_params& params,
+                               bool no_state);
+    std::shared_ptr<void> acquire_shared_model(
+        const whisper_context_params& params);
     samples_process_result_t process_buff() override;
     void decode_speech(const whisper_buf_t& buf);
+    whisper_full_params make_decode_wparams(const whisper_buf_t& buf);
+    void detect_lang_with_sup(const whisper_buf_t& buf,
+                              const whisper_full_params& wparams);
+    void reset_sup_lang();
+    decoded_t decode(void* state, const whisper_buf_t& buf,
+                     const whisper_full_params& wparams);
+    void emit_decoded(const decoded_t& decoded, size_t time_offset);
+    std::optional<decoded_segment_t> get_segment(void* state, int i);
+    std::string segments_to_text(
+        const std::vector<decoded_segment_t>& segments,
+        size_t time_offset) const;
+    static void new_segment_callback(void* ctx, void* state, int n_new,
+                                     void* user_data);
+    void emit_new_segments(void* state, int n_new);
+    bool use_offline_workers() const;
+    void start_offline_workers();
+    void stop_offline_workers();
+    void offline_worker_loop(cpu_tools::thread_lease lease);
+    void push_offline_job(whisper_buf_t&& buf, size_t time_offset);
+    void emit_offline_jobs(bool wait);
+    void clear_offline_jobs();
+    bool use_streaming() const;
+    decoded_t decode_stream_window();
+    void stream_decode();
+    void stream_decode_final();
+    void reset_stream();
     static void push_buf_to_whisper_buf(
         const std::vector<in_buf_t::buf_t::value_type>& buf,
         whisper_buf_t& whisper_buf);
@@ -0,0 +1,163 @@
+/* Copyright (C) 2025 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "audio_tools.hpp"
+
+static std::vector<int16_t> make_samples(size_t size) {
+    std::vector<int16_t> samples(size);
+    for (size_t i = 0; i < size; ++i)
+        samples[i] = static_cast<int16_t>(i * 7919);
+    if (size > 0) samples[0] = std::numeric_limits<int16_t>::min();
+    if (size > 1) samples[1] = std::numeric_limits<int16_t>::max();
+    return samples;
+}
+
+TEST_CASE("audio_tools", "[s16_to_f32]") {
+    SECTION("same as scalar") {
+        for (size_t size : {0, 1, 7, 8, 15, 16, 17, 33, 24000}) {
+            auto samples = make_samples(size);
+            std::vector<float> expected(size);
+            std::vector<float> out(size);
+
+            audio_tools::s16_to_f32_scalar(samples.data(), size,
+                                           expected.data());
+            audio_tools::s16_to_f32(samples.data(), size, out.data());
+
+            REQUIRE(out == expected);
+        }
+    }
+
+    SECTION("range") {
+        auto samples = make_samples(2);
+        std::vector<float> out(2);
+
+        audio_tools::s16_to_f32(samples.data(), samples.size(), out.data());
+
+        REQUIRE(out[0] == -1.0F);
+        REQUIRE(out[1] == 32767.0F / 32768.0F);
+    }
+
+    SECTION("append") {
+        auto samples = make_samples(20);
+        std::vector<float> out{0.5F};
+
+        audio_tools::append_s16_as_f32(samples.data(), samples.size(), out);
+
+        REQUIRE(out.size() == 21);
+        REQUIRE(out[0] == 0.5F);
+        REQUIRE(out[1] == -1.0F);
+    }
+}
+
+TEST_CASE("audio_tools", "[denoiser_kernels]") {
+    auto samples = make_samples(1003);
+
+    SECTION("peak") {
+        REQUIRE(audio_tools::peak_s16(samples.data(), samples.size()) ==
+                32768);
+        REQUIRE(audio_tools::peak_s16(samples.data() + 2, 100) ==
+                audio_tools::peak_s16_scalar(samples.data() + 2, 100));
+    }
+
+    SECTION("gain") {
+        for (int gain : {1 << 10, 3 << 10, 1500, 32 << 10}) {
+            auto out = samples;
+            auto expected = samples;
+
+            audio_tools::apply_gain_s16(out.data(), out.size(), gain);
+            audio_tools::apply_gain_s16_scalar(expected.data(),
+                                               expected.size(), gain);
+
+            REQUIRE(out == expected);
+        }
+    }
+
+    SECTION("unscaled conversion round trip") {
+        std::vector<float> frame(samples.size());
+        std::vector<int16_t> out(samples.size());
+
+        audio_tools::s16_to_f32_unscaled(samples.data(), samples.size(),
+                                         frame.data());
+        REQUIRE(frame[1] == 32767.0F);
+
+        audio_tools::f32_unscaled_to_s16(frame.data(), frame.size(),
+                                         out.data());
+        REQUIRE(out == samples);
+    }
+
+    SECTION("saturation and truncation") {
+        std::vector<float> frame{40000.0F, -40000.0F, 1.9F, -1.9F,
+                                 0.0F,     12.5F,     -0.5F, 32767.9F};
+        std::vector<int16_t> out(frame.size());
+
+        audio_tools::f32_unscaled_to_s16(frame.data(), frame.size(),
+                                         out.data());
+
+        REQUIRE(out ==
+                std::vector<int16_t>{32767, -32768, 1, -1, 0, 12, 0, 32767});
+    }
+}
+
+TEST_CASE("audio_tools benchmark", "[!benchmark][s16_to_f32]") {
+    // one in-buf block (1.5 s of 16 kHz audio)
+    auto samples = make_samples(24000);
+    std::vector<float> out(samples.size());
+
+    BENCHMARK("scalar") {
+        audio_tools::s16_to_f32_scalar(samples.data(), samples.size(),
+                                       out.data());
+        return out.back();
+    };
+
+    BENCHMARK("simd") {
+        audio_tools::s16_to_f32(samples.data(), samples.size(), out.data());
+        return out.back();
+    };
+}
+
+TEST_CASE("audio_tools denoiser benchmark",
+          "[!benchmark][denoiser_kernels]") {
+    auto samples = make_samples(24000);
+    std::vector<float> frame(samples.size());
+
+    BENCHMARK("peak scalar") {
+        return audio_tools::peak_s16_scalar(samples.data(), samples.size());
+    };
+
+    BENCHMARK("peak simd") {
+        return audio_tools::peak_s16(samples.data(), samples.size());
+    };
+
+    BENCHMARK("gain scalar") {
+        audio_tools::apply_gain_s16_scalar(samples.data(), samples.size(),
+                                           1 << 10);
+        return samples.back();
+    };
+
+    BENCHMARK("gain simd") {
+        audio_tools::apply_gain_s16(samples.data(), samples.size(), 1 << 10);
+        return samples.back();
+    };
+
+    BENCHMARK("f32 to s16 scalar") {
+        audio_tools::f32_unscaled_to_s16_scalar(frame.data(), frame.size(),
+                                                samples.data());
+        return samples.back();
+    };
+
+    BENCHMARK("f32 to s16 simd") {
+        audio_tools::f32_unscaled_to_s16(frame.data(), frame.size(),
+                                         samples.data());
+        return samples.back();
+    };
+}
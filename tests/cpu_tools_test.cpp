@@ -8,7 +8,10 @@
 #include "cpu_tools.hpp"
 
 #include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
 #include <sstream>
+#include <vector>
 
 TEST_CASE("cpu_tools", "[parse_cpuinfo]") {
     SECTION("parse_amd") {
@@ -157,3 +160,46 @@ CPU revision	: 5)";
         REQUIRE(cpuinfo == expected_cpuinfo);
     }
 }
+
+TEST_CASE("cpu_tools", "[parse_cpu_list]") {
+    REQUIRE(cpu_tools::parse_cpu_list("0-3,8,10-11\n") ==
+            std::vector<unsigned int>{0, 1, 2, 3, 8, 10, 11});
+    REQUIRE(cpu_tools::parse_cpu_list("").empty());
+}
+
+TEST_CASE("cpu_tools", "[parse_topology]") {
+    auto dir = std::filesystem::temp_directory_path() / "dsnote_test_sysfs";
+    std::filesystem::remove_all(dir);
+
+    auto write = [&](const std::string& file, const std::string& value) {
+        auto path = dir / file;
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream{path} << value << "\n";
+    };
+
+    // hybrid cpu: two performance cores with smt, two efficient cores
+    write("online", "0-5");
+    for (unsigned int cpu = 0; cpu < 6; ++cpu) {
+        auto cpu_dir = "cpu" + std::to_string(cpu);
+        write(cpu_dir + "/topology/core_cpus_list",
+              cpu < 4 ? (cpu < 2 ? "0-1" : "2-3") : std::to_string(cpu));
+        write(cpu_dir + "/cpufreq/cpuinfo_max_freq",
+              cpu < 4 ? "5000000" : "3800000");
+        write(cpu_dir + "/cache/index0/level", "1");
+        write(cpu_dir + "/cache/index0/size", "48K");
+        write(cpu_dir + "/cache/index1/level", "2");
+        write(cpu_dir + "/cache/index1/size", cpu < 4 ? "2048K" : "4096K");
+        write(cpu_dir + "/cache/index2/level", "3");
+        write(cpu_dir + "/cache/index2/size", "30M");
+    }
+
+    auto topology = cpu_tools::parse_topology(dir.string());
+
+    std::filesystem::remove_all(dir);
+
+    REQUIRE(topology.cores ==
+            std::vector<std::vector<unsigned int>>{{0, 1}, {2, 3}, {4}, {5}});
+    REQUIRE(topology.number_of_performance_cores == 2);
+    REQUIRE(topology.l2_cache_size == 4096 * 1024);
+    REQUIRE(topology.l3_cache_size == 30 * 1024 * 1024);
+}
@@ -0,0 +1,52 @@
+/* Copyright (C) 2025 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include <memory>
+
+#include "engines_cache.hpp"
+
+namespace {
+struct test_engine {};
+}  // namespace
+
+TEST_CASE("engines_cache", "[size]") {
+    engines_cache<test_engine> cache;
+    cache.set_max_size(100);
+
+    SECTION("engines with different models are counted separately") {
+        REQUIRE(cache.put("a", std::make_unique<test_engine>(), 40, "m1"));
+        REQUIRE(cache.put("b", std::make_unique<test_engine>(), 40, "m2"));
+
+        REQUIRE(cache.stats().size == 80);
+        REQUIRE(cache.stats().count == 2);
+    }
+
+    SECTION("engines with shared model are counted once") {
+        REQUIRE(cache.put("a", std::make_unique<test_engine>(), 60, "m1"));
+        REQUIRE(cache.put("b", std::make_unique<test_engine>(), 60, "m1"));
+
+        REQUIRE(cache.stats().size == 60);
+        REQUIRE(cache.stats().count == 2);
+        REQUIRE(cache.stats().evictions == 0);
+
+        REQUIRE(cache.take<test_engine>("b"));
+        REQUIRE(cache.stats().size == 60);
+        REQUIRE(cache.take<test_engine>("a"));
+        REQUIRE(cache.stats().size == 0);
+    }
+
+    SECTION("least recently used engine is evicted") {
+        REQUIRE(cache.put("a", std::make_unique<test_engine>(), 60));
+        REQUIRE(cache.put("b", std::make_unique<test_engine>(), 60));
+
+        REQUIRE(cache.stats().size == 60);
+        REQUIRE(cache.stats().evictions == 1);
+        REQUIRE_FALSE(cache.take<test_engine>("a"));
+        REQUIRE(cache.take<test_engine>("b"));
+    }
+}
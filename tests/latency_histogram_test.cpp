@@ -0,0 +1,37 @@
+/* Copyright (C) 2025 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "latency_histogram.hpp"
+
+TEST_CASE("latency_histogram", "[snapshot]") {
+    latency_histogram histogram;
+
+    SECTION("empty histogram") {
+        auto snapshot = histogram.snapshot();
+
+        REQUIRE(snapshot.count == 0);
+        REQUIRE(snapshot.mean_us() == 0);
+        REQUIRE(snapshot.percentile_us(0.5) == 0);
+    }
+
+    SECTION("durations are bucketed by power of two") {
+        for (int i = 0; i < 9; ++i)
+            histogram.add(std::chrono::microseconds{100});
+        histogram.add(std::chrono::microseconds{5000});
+
+        auto snapshot = histogram.snapshot();
+
+        REQUIRE(snapshot.count == 10);
+        REQUIRE(snapshot.total_us == 5900);
+        REQUIRE(snapshot.max_us == 5000);
+        REQUIRE(snapshot.mean_us() == 590);
+        REQUIRE(snapshot.percentile_us(0.5) == 128);
+        REQUIRE(snapshot.percentile_us(0.99) == 8192);
+    }
+}
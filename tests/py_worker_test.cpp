@@ -0,0 +1,80 @@
+/* Copyright (C) 2025 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <thread>
+
+#include "py_worker.hpp"
+
+TEST_CASE("py_worker", "[message]") {
+    int fds[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == 0);
+
+    std::string payload;
+    int attached_fd = -1;
+
+    SECTION("message round trip") {
+        py_worker::send_message(fds[0], R"({"cmd":"load"})");
+
+        REQUIRE(py_worker::recv_message(fds[1], payload, attached_fd));
+        REQUIRE(payload == R"({"cmd":"load"})");
+        REQUIRE(attached_fd == -1);
+    }
+
+    SECTION("empty message") {
+        py_worker::send_message(fds[0], {});
+
+        REQUIRE(py_worker::recv_message(fds[1], payload, attached_fd));
+        REQUIRE(payload.empty());
+    }
+
+    SECTION("message larger than socket buffer") {
+        std::string large(4 * 1024 * 1024, 'x');
+
+        std::thread sender{
+            [&] { py_worker::send_message(fds[0], large); }};
+
+        REQUIRE(py_worker::recv_message(fds[1], payload, attached_fd));
+        sender.join();
+
+        REQUIRE(payload == large);
+    }
+
+    SECTION("attached fd") {
+        int shm_fd = memfd_create("py-worker-test", MFD_CLOEXEC);
+        REQUIRE(shm_fd >= 0);
+        REQUIRE(write(shm_fd, "abc", 3) == 3);
+
+        py_worker::send_message(fds[0], "samples", shm_fd);
+        close(shm_fd);
+
+        REQUIRE(py_worker::recv_message(fds[1], payload, attached_fd));
+        REQUIRE(payload == "samples");
+        REQUIRE(attached_fd >= 0);
+
+        char buf[3]{};
+        REQUIRE(pread(attached_fd, buf, sizeof(buf), 0) == 3);
+        REQUIRE(std::string(buf, sizeof(buf)) == "abc");
+
+        close(attached_fd);
+    }
+
+    SECTION("eof when other side is closed") {
+        close(fds[0]);
+        fds[0] = -1;
+
+        REQUIRE_FALSE(py_worker::recv_message(fds[1], payload, attached_fd));
+    }
+
+    if (fds[0] >= 0) close(fds[0]);
+    close(fds[1]);
+}
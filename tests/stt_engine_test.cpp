@@ -41,3 +41,15 @@ TEST_CASE("stt_engine", "[merge_texts]") {
         REQUIRE(result == "Hello, How are you");
     }
 }
+
+TEST_CASE("stt_engine", "[text_overlap]") {
+    SECTION("no overlap") {
+        REQUIRE(stt_engine::text_overlap("abc", "def") == 0);
+        REQUIRE(stt_engine::text_overlap("", "def") == 0);
+    }
+
+    SECTION("longest overlap is found") {
+        REQUIRE(stt_engine::text_overlap("xaaba", "abaab") == 3);
+        REQUIRE(stt_engine::text_overlap("aaaa", "aaa") == 3);
+    }
+}
@@ -313,3 +313,20 @@ TEST_CASE("text_tools", "[subrip_text_start]") {
         REQUIRE_FALSE(start);
     }
 }
+
+TEST_CASE("text_tools", "[word_error_rate]") {
+    SECTION("same") {
+        REQUIRE(text_tools::word_error_rate("Hello, how are you?",
+                                            "hello how are you") == 0.0);
+    }
+
+    SECTION("substitution_and_deletion") {
+        REQUIRE(text_tools::word_error_rate("hello how are you",
+                                            "hello who you") == 0.5);
+    }
+
+    SECTION("empty_ref") {
+        REQUIRE(text_tools::word_error_rate("", "") == 0.0);
+        REQUIRE(text_tools::word_error_rate("", "hello") == 1.0);
+    }
+}
@@ -7,8 +7,11 @@
 
 #define private public
 
+#include <algorithm>
 #include <catch2/catch_test_macros.hpp>
+#include <memory>
 #include <string>
+#include <utility>
 
 #include "vad.hpp"
 
@@ -33,3 +36,65 @@ TEST_CASE("vad", "[shift_left]") {
         REQUIRE(buf.empty());
     }
 }
+
+namespace {
+// speech when chunk is loud, counts classified samples to catch chunks
+// passed to the backend more than once
+class test_backend : public vad::backend {
+   public:
+    explicit test_backend(size_t* classified) : m_classified{classified} {}
+    size_t chunk_size() const override { return 480; }
+    void restart() override {}
+    bool is_speech_chunk(const vad::buf_t::value_type* chunk) override {
+        *m_classified += chunk_size();
+        return chunk[0] > 1000;
+    }
+
+   private:
+    size_t* m_classified = nullptr;
+};
+
+// silence and speech segments of 16 kHz audio
+vad::buf_t make_audio() {
+    vad::buf_t audio;
+    for (auto [sec, level] : {std::pair{1.0, 0}, std::pair{2.5, 5000},
+                              std::pair{1.3, 0}, std::pair{0.7, 5000},
+                              std::pair{2.1, 0}, std::pair{1.9, 5000}}) {
+        audio.insert(audio.end(), static_cast<size_t>(sec * 16000),
+                     static_cast<int16_t>(level));
+    }
+    return audio;
+}
+
+vad::buf_t remove_silence(const vad::buf_t& audio, size_t frame_size,
+                          size_t* classified) {
+    vad v;
+    v.m_backend = std::make_unique<test_backend>(classified);
+    v.m_chunk_size = v.m_backend->chunk_size();
+
+    vad::buf_t output;
+    for (size_t pos = 0; pos < audio.size(); pos += frame_size) {
+        auto size = std::min(frame_size, audio.size() - pos);
+        const auto& out = v.remove_silence(audio.data() + pos, size);
+        output.insert(output.end(), out.cbegin(), out.cend());
+    }
+    return output;
+}
+}  // namespace
+
+TEST_CASE("vad", "[remove_silence]") {
+    auto audio = make_audio();
+
+    size_t classified = 0;
+    auto expected = remove_silence(audio, audio.size(), &classified);
+    REQUIRE_FALSE(expected.empty());
+
+    for (size_t frame_size : {480, 1000, 1600, 4096, 16000}) {
+        classified = 0;
+        auto output = remove_silence(audio, frame_size, &classified);
+
+        INFO("frame size: " << frame_size);
+        REQUIRE(classified == audio.size() - audio.size() % 480);
+        REQUIRE(output == expected);
+    }
+}